@@ -34,6 +34,7 @@
 #include "UObject/UnrealType.h"
 
 DEFINE_LOG_CATEGORY(LogSideFxLabsRuntime);
+LLM_DEFINE_TAG(SidefxLabsRuntime);
 
 /**
  * Default constructor for AHoudiniVatActor.
@@ -43,6 +44,8 @@ AHoudiniVatActor::AHoudiniVatActor()
 	: StartSeconds(0.0f)
 	, bPlay(true)
 {
+	LLM_SCOPE_BYTAG(SidefxLabsRuntime);
+
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("DefaultSceneRoot"));
 
 	Vat_StaticMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("VAT Mesh"));
@@ -80,6 +83,8 @@ AHoudiniVatActor::AHoudiniVatActor()
  */
 void AHoudiniVatActor::BeginPlay()
 {
+    LLM_SCOPE_BYTAG(SidefxLabsRuntime);
+
     Super::BeginPlay();
 
     if (!ensureMsgf(GetWorld(), TEXT("World is null in BeginPlay"))) { return; }
@@ -296,6 +301,8 @@ void AHoudiniVatActor::PostEditChangeProperty(FPropertyChangedEvent& PropertyCha
  */
 void AHoudiniVatActor::TriggerVatPlayback()
 {
+    LLM_SCOPE_BYTAG(SidefxLabsRuntime);
+
     UWorld* World = GetWorld();
 
 	if (!bPlay || !World)
@@ -356,6 +363,8 @@ void AHoudiniVatActor::TriggerVatPlayback()
  */
 void AHoudiniVatActor::ResetVatPlayback()
 {
+    LLM_SCOPE_BYTAG(SidefxLabsRuntime);
+
     if (!Vat_StaticMesh)
     {
         return;
@@ -427,6 +436,8 @@ void AHoudiniVatActor::ResetVatPlayback()
  */
 void AHoudiniVatActor::ApplyMaterials(const TArray<TObjectPtr<UMaterialInterface>>& Materials)
 {
+    LLM_SCOPE_BYTAG(SidefxLabsRuntime);
+
     if (!Vat_StaticMesh)
     {
         return;
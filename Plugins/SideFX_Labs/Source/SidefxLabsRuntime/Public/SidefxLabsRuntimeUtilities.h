@@ -26,5 +26,9 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSideFxLabsRuntime, Log, All);
+
+/** Low-Level Memory tracker tag for SidefxLabsRuntime allocations (-llm, stat LLM). */
+LLM_DECLARE_TAG_API(SidefxLabsRuntime, SIDEFXLABSRUNTIME_API);
@@ -21,7 +21,7 @@ public class Stadium56 : ModuleRules
 			"Slate"
         });
 
-		PrivateDependencyModuleNames.AddRange(new string[] { });
+		PrivateDependencyModuleNames.AddRange(new string[] { "RenderCore" });
 
 		PublicIncludePaths.AddRange(new string[] {
 			"Stadium56",
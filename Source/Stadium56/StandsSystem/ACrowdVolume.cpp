@@ -20,6 +20,7 @@ AACrowdVolume::AACrowdVolume()
 
 	CrowdDensity = 0.8f; // defaykt
 	RandomSeed = -487486592;
+	bOverrideMaterialWeights = false;
 }
 
 void AACrowdVolume::OnConstruction(const FTransform& Transform)
@@ -50,7 +51,7 @@ void AACrowdVolume::PostEditMove(bool bFinished)
 	// bFinished - > move eended
 	if (bFinished && CrowdManager)
 	{
-		CrowdManager->BakeCrowd();
+		CrowdManager->RebakeVolume(this);
 	}
 }
 
@@ -60,7 +61,7 @@ void AACrowdVolume::PostEditChangeProperty(FPropertyChangedEvent& PropertyChange
 
 	if (!CrowdManager) return;
 	if (PropertyChangedEvent.ChangeType == EPropertyChangeType::Interactive) return;
-	CrowdManager->BakeCrowd();
+	CrowdManager->RebakeVolume(this);
 }
 
 // Called when the game starts or when spawned
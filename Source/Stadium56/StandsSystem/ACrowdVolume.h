@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/BoxComponent.h"
+#include "StandsSystem/CrowdWeights.h"
 #include "ACrowdVolume.generated.h"
 
 class AAGlobalCrowdManager;
@@ -46,4 +47,11 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm")
 	int32 RandomSeed;
+
+	// use this section's own animation weights instead of the manager's
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Weights")
+	bool bOverrideMaterialWeights;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Weights", meta = (EditCondition = "bOverrideMaterialWeights"))
+	FMaterialWeights MaterialWeights;
 };
@@ -2,18 +2,212 @@
 
 
 #include "StandsSystem/AGlobalCrowdManager.h"
+#include "StandsSystem/CrowdBake.h"
 #include "StandsSystem/AGlobalSeatManager.h"
+#include "StandsSystem/StandsHISMComponent.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Components/SceneComponent.h"
 #include "StandsSystem/ACrowdVolume.h"
+#include "StandsSystem/StandsRandom.h"
+#include "StandsSystem/SpatialOrder.h"
+#include "StandsSystem/StandsBakedData.h"
+#include "StandsSystem/StandsStats.h"
+#include "StandsSystem/StandsAllocCounter.h"
+#include "StandsSystem/StandsBenchmark.h"
+#include "Async/ParallelFor.h"
 #include "EngineUtils.h"
-#include "Templates/TypeHash.h"
+#include "Misc/Crc.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+#include "LatentActions.h"
+#include "Tasks/Task.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+
+// instances per AddInstances call of an async bake, the budget is checked in between
+static constexpr int32 AsyncBakeBatchSize = 1024;
+
+// seats per ParallelFor block of the pick pass. cancel and progress are checked per block
+static constexpr int32 PickSeatsBlockSize = 4096;
+
+// seats per crowd LOD move, the budget is checked in between
+static constexpr int32 LodMoveBatchSize = 1024;
+
+// add instances, then their custom data through SetCustomData so the engine tracks the changes.
+// no render state invalidation per instance: one at the end, or none when the caller dirties once later
+static void AddInstancesWithCustomData(UHierarchicalInstancedStaticMeshComponent* HISM, const TArray<FTransform>& Transforms, const TArray<float>& CustomData, bool bMarkRenderStateDirty = true)
+{
+	const int32 NumFloats = HISM->NumCustomDataFloats;
+	const int32 FirstInstance = HISM->GetInstanceCount();
+
+	HISM->AddInstances(Transforms, false, false, false);
+
+	// AddInstances zero fills the new custom data slots
+	if (NumFloats > 0 && CustomData.Num() == Transforms.Num() * NumFloats)
+	{
+		for (int32 k = 0; k < Transforms.Num(); ++k)
+		{
+			HISM->SetCustomData(FirstInstance + k, MakeArrayView(CustomData.GetData() + k * NumFloats, NumFloats), false);
+		}
+	}
+
+	if (bMarkRenderStateDirty)
+	{
+		HISM->MarkRenderStateDirty();
+	}
+}
+
+// take these seats' instances out of their components. holes below the new count are filled from the
+// surviving tail, then the tail goes, so one batch is one RemoveInstances per component and nothing reorders.
+// Slots is per seat (X = component, Y = instance), InstanceSeats per component (instance -> seat)
+static void RemoveSeatInstances(const TArray<int32>& Seats, const TArray<UHierarchicalInstancedStaticMeshComponent*>& Components,
+	TArray<FIntPoint>& Slots, TArray<TArray<int32>>& InstanceSeats, TBitArray<>& Touched)
+{
+	if (Seats.Num() == 0) return;
+
+	TArray<TArray<int32>> Holes;
+	Holes.SetNum(Components.Num());
+	for (const int32 SeatIdx : Seats)
+	{
+		const FIntPoint Slot = Slots[SeatIdx];
+		if (Slot.X == INDEX_NONE) continue;
+
+		Holes[Slot.X].Add(Slot.Y);
+		Slots[SeatIdx] = FIntPoint(INDEX_NONE, INDEX_NONE);
+	}
+
+	TBitArray<> Gone;
+	TArray<int32> TailIndices;
+	for (int32 c = 0; c < Components.Num(); ++c)
+	{
+		if (Holes[c].Num() == 0) continue;
+
+		UHierarchicalInstancedStaticMeshComponent* HISM = Components[c];
+		TArray<int32>& CompSeats = InstanceSeats[c];
+		const int32 NumFloats = HISM->NumCustomDataFloats;
+		const int32 Count = CompSeats.Num();
+		const int32 NewCount = Count - Holes[c].Num();
+
+		Gone.Init(false, Count);
+		for (const int32 InstanceIdx : Holes[c])
+		{
+			Gone[InstanceIdx] = true;
+		}
+
+		int32 Tail = Count - 1;
+		for (const int32 InstanceIdx : Holes[c])
+		{
+			if (InstanceIdx >= NewCount) continue;
+
+			// last instance that stays
+			while (Gone[Tail]) --Tail;
+			Gone[Tail] = true;
+
+			FTransform TailTransform;
+			HISM->GetInstanceTransform(Tail, TailTransform, false);
+			HISM->UpdateInstanceTransform(InstanceIdx, TailTransform, false, false, true);
+			for (int32 f = 0; f < NumFloats; ++f)
+			{
+				HISM->SetCustomDataValue(InstanceIdx, f, HISM->PerInstanceSMCustomData[Tail * NumFloats + f], false);
+			}
+
+			CompSeats[InstanceIdx] = CompSeats[Tail];
+			Slots[CompSeats[InstanceIdx]].Y = InstanceIdx;
+		}
+
+		// highest first, the HISM override takes no sorted flag
+		TailIndices.Reset();
+		for (int32 InstanceIdx = Count - 1; InstanceIdx >= NewCount; --InstanceIdx)
+		{
+			TailIndices.Add(InstanceIdx);
+		}
+		HISM->RemoveInstances(TailIndices);
+		CompSeats.SetNum(NewCount, EAllowShrinking::No);
+		Touched[c] = true;
+	}
+}
+
+// append instances for these seats, Slots and InstanceSeats as above. neither dirties the render state,
+// the caller marks each touched component once
+static void AddSeatInstances(const TArray<int32>& Seats, UHierarchicalInstancedStaticMeshComponent* HISM, int32 ComponentIdx,
+	const TArray<FTransform>& Transforms, const TArray<float>& CustomData, TArray<FIntPoint>& Slots, TArray<int32>& InstanceSeats)
+{
+	const int32 FirstInstance = HISM->GetInstanceCount();
+	AddInstancesWithCustomData(HISM, Transforms, CustomData, false);
+	for (int32 k = 0; k < Seats.Num(); ++k)
+	{
+		Slots[Seats[k]] = FIntPoint(ComponentIdx, FirstInstance + k);
+	}
+	InstanceSeats.Append(Seats);
+}
+
+// BakeCrowdLatent. follows the async bake it started, by serial
+class FCrowdBakeLatentAction : public FPendingLatentAction
+{
+public:
+	FCrowdBakeLatentAction(AAGlobalCrowdManager* InManager, uint32 InSerial, const FLatentActionInfo& LatentInfo, ECrowdBakeLatentResult& InResult, float& InProgress)
+		: Manager(InManager)
+		, Serial(InSerial)
+		, ExecutionFunction(LatentInfo.ExecutionFunction)
+		, OutputLink(LatentInfo.Linkage)
+		, CallbackTarget(LatentInfo.CallbackTarget)
+		, Result(InResult)
+		, Progress(InProgress)
+	{
+	}
+
+	virtual void UpdateOperation(FLatentResponse& Response) override
+	{
+		const AAGlobalCrowdManager* CrowdManager = Manager.Get();
+		if (CrowdManager && CrowdManager->CompletedBakeSerial == Serial)
+		{
+			Progress = 1.0f;
+			Result = ECrowdBakeLatentResult::Completed;
+			Response.FinishAndTriggerIf(true, ExecutionFunction, OutputLink, CallbackTarget);
+			return;
+		}
+
+		// manager gone, cancelled, or a newer bake took over
+		if (!CrowdManager || CrowdManager->AsyncBakeSerial != Serial || !CrowdManager->AsyncBake.IsValid())
+		{
+			Result = ECrowdBakeLatentResult::Cancelled;
+			Response.FinishAndTriggerIf(true, ExecutionFunction, OutputLink, CallbackTarget);
+			return;
+		}
+
+		Progress = CrowdManager->GetCrowdBakeProgress();
+		Result = ECrowdBakeLatentResult::Progress;
+		Response.TriggerLink(ExecutionFunction, OutputLink, CallbackTarget);
+	}
+
+#if WITH_EDITOR
+	virtual FString GetDescription() const override
+	{
+		return FString::Printf(TEXT("Baking crowd %.0f%%"), Progress * 100.0f);
+	}
+#endif
+
+private:
+	TWeakObjectPtr<AAGlobalCrowdManager> Manager;
+	uint32 Serial;
+	FName ExecutionFunction;
+	int32 OutputLink;
+	FWeakObjectPtr CallbackTarget;
+	ECrowdBakeLatentResult& Result;
+	float& Progress;
+};
 
 // Sets default values
 AAGlobalCrowdManager::AAGlobalCrowdManager()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	// crowd LOD only, BeginPlay turns it on
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	DefaultSceneRoot = CreateDefaultSubobject<USceneComponent>(TEXT("DefaultSceneRoot"));
 	RootComponent = DefaultSceneRoot;
@@ -23,6 +217,20 @@ AAGlobalCrowdManager::AAGlobalCrowdManager()
 
 	//bBakeCrowd = false;
 	bHasInitialBaked = false;
+	CrowdRandomSeed = 0;
+	bSingleHISMPerMesh = false;
+	AsyncBakeBudgetMs = 2.0f;
+
+	bEnableCrowdLod = false;
+	LodFullDistance = 5000.0f;
+	LodFarDistance = 15000.0f;
+	LodMaxFullInstances = 20000;
+	LodMaxFrozenInstances = 60000;
+	LodFarKeepFraction = 0.25f;
+	LodUpdateInterval = 0.25f;
+	LodBudgetMs = 1.0f;
+
+	CrowdSignalCollection = nullptr;
 }
 
 void AAGlobalCrowdManager::OnConstruction(const FTransform& Transform)
@@ -38,6 +246,9 @@ void AAGlobalCrowdManager::OnConstruction(const FTransform& Transform)
 
 void AAGlobalCrowdManager::ClearCrowd()
 {
+	// parked members go with it
+	ResetCrowdLod();
+
 	for (UHierarchicalInstancedStaticMeshComponent* HISM : CrowdHISMs)
 	{
 		if (HISM)
@@ -47,18 +258,27 @@ void AAGlobalCrowdManager::ClearCrowd()
 	}
 }
 
-void AAGlobalCrowdManager::SetupHISMComponents()
+int32 AAGlobalCrowdManager::GetNumHISMsNeeded() const
 {
 	const int32 NumVariants = CrowdCharacterVariants.Num();
-	const int32 NumMatsPerVariant = CrowdCharacterVariants.Num() > 0 ? CrowdCharacterVariants[0].VATMats.Num() : 0;
-	const int32 TotalHISMsNeeded = NumVariants * NumMatsPerVariant;
+	const int32 NumMatsPerVariant = NumVariants > 0 ? CrowdCharacterVariants[0].VATMats.Num() : 0;
+	return bSingleHISMPerMesh ? (NumMatsPerVariant > 0 ? NumVariants : 0) : NumVariants * NumMatsPerVariant;
+}
+
+void AAGlobalCrowdManager::SetupHISMComponents()
+{
+	STANDS_SCOPE(STAT_Stands_SetupHISMComponents);
+
+	const int32 TotalHISMsNeeded = GetNumHISMsNeeded();
+	const int32 NumCustomData = bSingleHISMPerMesh ? CrowdCustomData::NumSingleHISM : CrowdCustomData::NumPerClipHISM;
 
 	bool bIsHISMsInvalid = (CrowdHISMs.Num() != TotalHISMsNeeded);
 	if (!bIsHISMsInvalid)
 	{
 		for (UHierarchicalInstancedStaticMeshComponent* HISM : CrowdHISMs)
 		{
-			if (!HISM)
+			// plain HISMs from an older save would be cooked with their instances
+			if (!HISM || !HISM->IsA<UStandsHISMComponent>())
 			{
 				bIsHISMsInvalid = true;
 				break;
@@ -84,26 +304,51 @@ void AAGlobalCrowdManager::SetupHISMComponents()
 		for (int32 i = 0; i < TotalHISMsNeeded; ++i)
 		{
 			FName HismName = FName(*FString::Printf(TEXT("CrowdHISM_%d"), i));
-			UHierarchicalInstancedStaticMeshComponent* NewHISM = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, HismName);
+			UHierarchicalInstancedStaticMeshComponent* NewHISM = NewObject<UStandsHISMComponent>(this, HismName);
 			NewHISM->SetupAttachment(HISMsRoot);
 			NewHISM->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 			NewHISM->RegisterComponent();
 
 			// stop gizmo highlight  SLOW!!!!
 			NewHISM->bSelectable = false;
-			// enable custom data!!!!!!
-			NewHISM->NumCustomDataFloats = 1;
 
 			CrowdHISMs.Add(NewHISM);
 		}
 	}
 
+	// enable custom data!!!!!! cleared above, so resizing is free
+	for (UHierarchicalInstancedStaticMeshComponent* HISM : CrowdHISMs)
+	{
+		if (HISM && HISM->NumCustomDataFloats != NumCustomData)
+		{
+			HISM->SetNumCustomDataFloats(NumCustomData);
+		}
+
+		// trees are built async once a HISM has all its instances
+		if (HISM)
+		{
+			HISM->bAutoRebuildTreeOnInstanceChanges = false;
+		}
+	}
+
 	// setup 
 	for (int32 VariantIdx = 0; VariantIdx < NumVariants; ++VariantIdx)
 	{
 		const FCharacterVariant& Variant = CrowdCharacterVariants[VariantIdx];
 		if (!Variant.Mesh) continue; // empty
 
+		if (bSingleHISMPerMesh)
+		{
+			// clip comes from custom data, fall back to the first clip's material
+			UMaterialInterface* Mat = Variant.ClipArrayMat ? Variant.ClipArrayMat : (Variant.VATMats.Num() > 0 ? Variant.VATMats[0] : nullptr);
+			if (CrowdHISMs.IsValidIndex(VariantIdx) && CrowdHISMs[VariantIdx])
+			{
+				CrowdHISMs[VariantIdx]->SetStaticMesh(Variant.Mesh);
+				CrowdHISMs[VariantIdx]->SetMaterial(0, Mat);
+			}
+			continue;
+		}
+
 		for (int32 MatIdx = 0; MatIdx < NumMatsPerVariant; ++MatIdx)
 		{
 			int32 HISM_Index = (VariantIdx * NumMatsPerVariant) + MatIdx;
@@ -117,22 +362,31 @@ void AAGlobalCrowdManager::SetupHISMComponents()
 	}
 }
 
-TArray<FTransform> AAGlobalCrowdManager::GetFilteredSeatTransforms() const
+void AAGlobalCrowdManager::BuildBakeContext(FCrowdBakeContext& OutContext) const
 {
-	TArray<FTransform> FilteredSeats;
+	STANDS_SCOPE(STAT_Stands_BuildBakeContext);
+
+	OutContext.NumMeshes = CrowdCharacterVariants.Num();
+	// get zeroth's mat num
+	OutContext.NumMats = CrowdCharacterVariants.Num() > 0 ? CrowdCharacterVariants[0].VATMats.Num() : 0;
+	OutContext.NumHISMs = CrowdHISMs.Num();
+	OutContext.bClipInCustomData = bSingleHISMPerMesh;
+	OutContext.RandomSeed = CrowdRandomSeed;
+	OutContext.InstanceOffset = OffsetTransform;
 
-	if (!SeatManager)
+	// hold the seats, a refcount instead of a copy
+	if (SeatManager)
 	{
-		return FilteredSeats;
+		OutContext.Seats = SeatManager->GetSeatLayout();
+	}
+	else
+	{
+		OutContext.Seats = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
 	}
 
-	// 1. get transforms from seat manager
-	const TArray<FTransform> AllSeats = SeatManager->AllTransforms;
-
-	if (AllSeats.Num() == 0) return FilteredSeats;
-
-	// 2. search ACrowdVolume
-	TArray<AACrowdVolume*> Volumes;
+	// search ACrowdVolume
+	TArray<const AACrowdVolume*>& Volumes = OutContext.Volumes;
+	Volumes.Reset();
 	if (UWorld* World = GetWorld())
 	{
 		for (TActorIterator<AACrowdVolume> It(World); It; ++It)
@@ -141,168 +395,1694 @@ TArray<FTransform> AAGlobalCrowdManager::GetFilteredSeatTransforms() const
 		}
 	}
 
-	if (Volumes.Num() == 0) return FilteredSeats;
+	// volume bounds once per bake, bucketed by XY
+	OutContext.VolumeBoxes.Reset(Volumes.Num());
+	OutContext.VolumeSeeds.Reset(Volumes.Num());
+	OutContext.VolumeDensities.Reset(Volumes.Num());
+	for (const AACrowdVolume* Volume : Volumes)
+	{
+		OutContext.VolumeBoxes.Add(Volume ? Volume->GetQueryBox() : FBox(ForceInit));
+		OutContext.VolumeSeeds.Add(Volume ? Volume->RandomSeed : 0);
+		OutContext.VolumeDensities.Add(Volume ? Volume->CrowdDensity : 0.0f);
+	}
+	OutContext.VolumeGrid.Build(OutContext.VolumeBoxes);
+
+	// weight profiles -> alias tables. [0] is the manager's
+	const int32 NumMats = OutContext.NumMats;
+	OutContext.WeightTables.Reset();
+	OutContext.WeightTables.AddDefaulted_GetRef().Build(MaterialWeights, FMath::Min(NumMats, MaterialWeights.GetNumWeights()));
+
+	OutContext.VolumeWeightTable.Init(0, Volumes.Num());
+	for (int32 VolumeIdx = 0; VolumeIdx < Volumes.Num(); ++VolumeIdx)
+	{
+		const AACrowdVolume* Volume = Volumes[VolumeIdx];
+		if (Volume && Volume->bOverrideMaterialWeights)
+		{
+			OutContext.VolumeWeightTable[VolumeIdx] = OutContext.WeightTables.Num();
+			OutContext.WeightTables.AddDefaulted_GetRef().Build(Volume->MaterialWeights, FMath::Min(NumMats, Volume->MaterialWeights.GetNumWeights()));
+		}
+	}
+}
+
+int32 AAGlobalCrowdManager::FindSeatVolume(const FCrowdBakeContext& Context, const FVector& SeatLocation)
+{
+	// only volumes sharing the seat's cell. first in iterator order wins
+	const int32 VolumeIdx = Context.VolumeGrid.FindFirstContaining(SeatLocation);
+	if (VolumeIdx == INDEX_NONE) return INDEX_NONE;
+
+	// density from volume
+	const uint32 SeatId = FStandsRandom::SeatId(SeatLocation);
+	if (FStandsRandom::Fraction(Context.VolumeSeeds[VolumeIdx], SeatId, EStandsRandomStream::Density) < Context.VolumeDensities[VolumeIdx])
+	{
+		return VolumeIdx;
+	}
+	return INDEX_NONE;
+}
+
+int32 AAGlobalCrowdManager::PickSeatHISM(const FCrowdBakeContext& Context, const FVector& SeatLocation, int32 VolumeIdx, float& OutTimeOffset, int32& OutClipIdx)
+{
+	// every pick hashes the seat, no shared random state
+	const uint32 SeatId = FStandsRandom::SeatId(SeatLocation);
+
+	// select a combination of mesh and mat
+	const int32 MeshIdx = FStandsRandom::RandRange(Context.RandomSeed, SeatId, EStandsRandomStream::Mesh, 0, Context.NumMeshes - 1);
+
+	// weighted pick, O(1)
+	const FCrowdAliasTable& WeightTable = Context.WeightTables[Context.VolumeWeightTable[VolumeIdx]];
+	const int32 MatIdx = WeightTable.Pick(FStandsRandom::Fraction(Context.RandomSeed, SeatId, EStandsRandomStream::Material));
+	if (MatIdx == INDEX_NONE) return INDEX_NONE; //no mat found
 
+	OutTimeOffset = FStandsRandom::Fraction(Context.RandomSeed, SeatId, EStandsRandomStream::TimeOffset);
+	OutClipIdx = MatIdx;
+	return Context.bClipInCustomData ? MeshIdx : (MeshIdx * Context.NumMats) + MatIdx;
+}
+
+void AAGlobalCrowdManager::PickSeats(FCrowdBakePlan& Plan, FCrowdSeatPicks& OutPicks)
+{
+	STANDS_SCOPE(STAT_Stands_FilterSeats);
+
+	const FCrowdBakeContext& Context = Plan.Context;
 
-	// 4. expensive: filter seats by volumes
-	for (const FTransform& SeatTransform : AllSeats)
+	// the snapshot the context holds, no copy
+	const FSeatLayout& Layout = *Context.Seats;
+	const int32 NumSeats = Layout.Num();
+
+	OutPicks.Hism.SetNumUninitialized(NumSeats);
+	OutPicks.TimeOffset.SetNumUninitialized(NumSeats);
+	OutPicks.Clip.SetNumUninitialized(NumSeats);
+	OutPicks.HismCounts.SetNumZeroed(Context.NumHISMs);
+
+	// expensive: filter by volumes, then pick. every seat hashes its own randoms, so blocks are independent.
+	// workers only write into what this thread allocated
+	const int32 NumBlocks = FMath::DivideAndRoundUp(NumSeats, PickSeatsBlockSize);
+	ParallelFor(NumBlocks, [&Plan, &Context, &Layout, &OutPicks, NumSeats](int32 Block)
 	{
-		const FVector SeatLocation = SeatTransform.GetLocation();
+		// async bake cancelled by a newer one
+		if (Plan.bCancelled) return;
 
-		for (AACrowdVolume* Volume : Volumes)
+		const int32 First = Block * PickSeatsBlockSize;
+		const int32 Last = FMath::Min(First + PickSeatsBlockSize, NumSeats);
+		for (int32 SeatIdx = First; SeatIdx < Last; ++SeatIdx)
 		{
-			if (Volume && Volume->GetQueryBox().IsInside(SeatLocation))
+			const FVector SeatLocation = Layout.GetLocation(SeatIdx);
+			int32 HismIdx = INDEX_NONE;
+			float TimeOffset = 0.0f;
+			int32 ClipIdx = 0;
+
+			const int32 VolumeIdx = FindSeatVolume(Context, SeatLocation);
+			if (VolumeIdx != INDEX_NONE)
 			{
-				//// density from volume
-				//FRandomStream Stream(Volume->RandomSeed + FMath::TruncToInt(SeatLocation.X*-2000.f + SeatLocation.Y*100.f));
-				// density from volumec
-				const int32 LocationHash = GetTypeHash(SeatLocation);
-				FRandomStream Stream(Volume->RandomSeed + LocationHash);
+				HismIdx = PickSeatHISM(Context, SeatLocation, VolumeIdx, TimeOffset, ClipIdx);
+			}
 
-				if (Stream.GetFraction() < Volume->CrowdDensity)
-				{
-					FilteredSeats.Add(SeatTransform);
-				}
+			// variants without a HISM (mat count mismatch) stay empty
+			OutPicks.Hism[SeatIdx] = HismIdx < Context.NumHISMs ? HismIdx : INDEX_NONE;
+			OutPicks.TimeOffset[SeatIdx] = TimeOffset;
+			OutPicks.Clip[SeatIdx] = ClipIdx;
+		}
+		Plan.NumSeatsScanned += Last - First;
+	});
+	if (Plan.bCancelled) return;
 
-				// found a volume. stop check for this seat
-				break;
-			}
+	// count, cheap next to the picks
+	for (const int32 HismIdx : OutPicks.Hism)
+	{
+		if (HismIdx != INDEX_NONE)
+		{
+			++OutPicks.HismCounts[HismIdx];
 		}
 	}
-
-	return FilteredSeats;
 }
 
-void AAGlobalCrowdManager::PopulateHISMs(const TArray<FTransform>& FilteredSeats)
+void AAGlobalCrowdManager::BuildBakePlan(FCrowdBakePlan& Plan)
 {
-	const int32 NumMeshes = CrowdCharacterVariants.Num(); 
-	// get zeroth's mat num
-	const int32 NumMats = CrowdCharacterVariants.Num() > 0 ? CrowdCharacterVariants[0].VATMats.Num() : 0;
-	const int32 TotalHISMs = CrowdHISMs.Num();
+	STANDS_SCOPE(STAT_Stands_BuildBakePlan);
+
+	const FCrowdBakeContext& Context = Plan.Context;
+	const int32 TotalHISMs = Context.NumHISMs;
 
 	// validate
-	if (NumMats == 0 || TotalHISMs == 0) return;
+	if (Context.NumMats == 0 || TotalHISMs == 0) return;
+	if (Context.Seats->Num() == 0 || Context.Volumes.Num() == 0) return;
 
-	// transform of each hism
-	TArray<TArray<FTransform>> HismTransforms;
-	HismTransforms.SetNum(TotalHISMs);
+	// all per seat scratch goes in one go at the end of the scope
+	FMemMark Mark(FMemStack::Get());
 
-	// custom data of each hism    -> for random time offset
-	TArray<TArray<float>> HismCustomData;
-	HismCustomData.SetNum(TotalHISMs);
+	// 1. count: picks and instances per HISM
+	FCrowdSeatPicks Picks;
+	PickSeats(Plan, Picks);
+	if (Plan.bCancelled) return;
+
+	const FSeatLayout& Layout = *Context.Seats;
+	const int32 NumFloats = Context.bClipInCustomData ? CrowdCustomData::NumSingleHISM : CrowdCustomData::NumPerClipHISM;
+
+	// 2. exact sizes, one allocation per array. transforms, custom data (random time offset), and
+	// the seat of each instance for the delta bake back map
+	Plan.HismTransforms.SetNum(TotalHISMs);
+	Plan.HismCustomData.SetNum(TotalHISMs);
+	Plan.HismSeats.SetNum(TotalHISMs);
+	for (int32 HismIdx = 0; HismIdx < TotalHISMs; ++HismIdx)
+	{
+		const int32 Count = Picks.HismCounts[HismIdx];
+		Plan.HismTransforms[HismIdx].SetNumUninitialized(Count);
+		Plan.HismCustomData[HismIdx].SetNumUninitialized(Count * NumFloats);
+		Plan.HismSeats[HismIdx].SetNumUninitialized(Count);
+		Plan.NumInstances += Count;
+	}
 
 	// deprecated, invert in bp onconstruction
 	//const FTransform ManagerInverseWorldTransform = GetActorTransform().Inverse();
 
-
-	for (const FTransform& WorldSeatTransform : FilteredSeats)
+	// 3. fill in seat order
+	TArray<int32, TMemStackAllocator<>> Cursors;
+	Cursors.SetNumZeroed(TotalHISMs);
+	for (int32 SeatIdx = 0; SeatIdx < Layout.Num(); ++SeatIdx)
 	{
-		// select a combination of mesh and mat
-		const int32 MeshIdx = FMath::RandRange(0, NumMeshes - 1);
+		const int32 HismIdx = Picks.Hism[SeatIdx];
+		if (HismIdx == INDEX_NONE) continue;
 
-		// weighted pick
-		const FCharacterVariant& Variant = CrowdCharacterVariants[MeshIdx];
-		const int32 MatIdx = PickMIByWeight();
-		if (MatIdx == -1) continue; //no mat found
+		const int32 InstanceIdx = Cursors[HismIdx]++;
 
-		const int32 HismIndex = (MeshIdx * NumMats) + MatIdx;
+		// the seat becomes a transform only here, on its way to the HISM
+		Plan.HismTransforms[HismIdx][InstanceIdx] = Context.InstanceOffset * Layout.GetTransform(SeatIdx);
+		float* CustomData = Plan.HismCustomData[HismIdx].GetData() + InstanceIdx * NumFloats;
+		CustomData[CrowdCustomData::TimeOffset] = Picks.TimeOffset[SeatIdx];
+		if (Context.bClipInCustomData)
+		{
+			CustomData[CrowdCustomData::ClipIndex] = static_cast<float>(Picks.Clip[SeatIdx]);
+		}
+		Plan.HismSeats[HismIdx][InstanceIdx] = SeatIdx;
+	}
 
-		const float RandomDataForThisInstance = FMath::FRand();
+	// 4. picks come in seat order spread over all HISMs. z-order each HISM for tight clusters
+	ParallelFor(TotalHISMs, [&Plan, NumFloats](int32 HismIdx)
+	{
+		TArray<int32> Order;
+		FSpatialOrder::SortByMorton(Plan.HismTransforms[HismIdx], Order);
+		FSpatialOrder::Permute(Plan.HismTransforms[HismIdx], Order);
+		FSpatialOrder::Permute(Plan.HismCustomData[HismIdx], Order, NumFloats);
+		FSpatialOrder::Permute(Plan.HismSeats[HismIdx], Order);
+	});
+}
 
-		HismTransforms[HismIndex].Add(OffsetTransform * WorldSeatTransform);
-		HismCustomData[HismIndex].Add(RandomDataForThisInstance);
-	}
+bool AAGlobalCrowdManager::ApplyBakePlan(FCrowdBakePlan& Plan, double BudgetSeconds, int32 BatchSize)
+{
+	STANDS_SCOPE(STAT_Stands_PopulateHISMs);
 
-	for (int32 i = 0; i < TotalHISMs; ++i)
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FTransform>& SliceTransforms = Plan.SliceTransforms;
+	TArray<float>& SliceCustomData = Plan.SliceCustomData;
+
+	while (Plan.ApplyHism < Plan.HismTransforms.Num())
 	{
-		if (CrowdHISMs[i] && HismTransforms[i].Num() > 0)
+		const int32 HismIdx = Plan.ApplyHism;
+		UHierarchicalInstancedStaticMeshComponent* HISM = CrowdHISMs.IsValidIndex(HismIdx) ? CrowdHISMs[HismIdx] : nullptr;
+		const TArray<FTransform>& Transforms = Plan.HismTransforms[HismIdx];
+		const TArray<float>& CustomData = Plan.HismCustomData[HismIdx];
+		const TArray<int32>& Seats = Plan.HismSeats[HismIdx];
+
+		const int32 First = Plan.ApplyInstance;
+		const int32 Count = FMath::Min(BatchSize, Transforms.Num() - First);
+		if (HISM && Count > 0)
 		{
-			// add instances in batches
-			CrowdHISMs[i]->AddInstances(HismTransforms[i], true);
+			const int32 FirstInstance = HISM->GetInstanceCount();
+			if (Count == Transforms.Num())
+			{
+				// transforms and custom data in one batch
+				AddInstancesWithCustomData(HISM, Transforms, CustomData, false);
+			}
+			else
+			{
+				// time sliced, one batch of this HISM
+				const int32 NumFloats = CustomData.Num() / Transforms.Num();
+				SliceTransforms.Reset();
+				SliceTransforms.Append(Transforms.GetData() + First, Count);
+				SliceCustomData.Reset();
+				SliceCustomData.Append(CustomData.GetData() + First * NumFloats, Count * NumFloats);
+				// render state once the HISM is complete, not per batch
+				AddInstancesWithCustomData(HISM, SliceTransforms, SliceCustomData, false);
+			}
+
+			// back map for delta bakes, sized once per HISM
+			if (First == 0)
+			{
+				HismInstanceSeats[HismIdx].Reserve(HismInstanceSeats[HismIdx].Num() + Seats.Num());
+			}
+			for (int32 k = 0; k < Count; ++k)
+			{
+				SeatInstanceSlots[Seats[First + k]] = FIntPoint(HismIdx, FirstInstance + k);
+			}
+			HismInstanceSeats[HismIdx].Append(Seats.GetData() + First, Count);
+		}
 
-			// add custom data one by one
-			const TArray<float>& CustomDataForThisHISM = HismCustomData[i];
-			const int32 NumInstancesInThisHISM = CustomDataForThisHISM.Num();
-			for (int32 j = 0; j < NumInstancesInThisHISM; ++j)
+		Plan.NumApplied += Count;
+		Plan.ApplyInstance += Count;
+		if (Plan.ApplyInstance >= Transforms.Num())
+		{
+			// all in, one render state update and one async tree build for the HISM
+			if (HISM)
 			{
-				// custom index = 0
-				CrowdHISMs[i]->SetCustomDataValue(j, 0, CustomDataForThisHISM[j]);
+				HISM->MarkRenderStateDirty();
+				HISM->BuildTreeIfOutdated(true, false);
 			}
+			++Plan.ApplyHism;
+			Plan.ApplyInstance = 0;
 		}
+
+		if (FPlatformTime::Seconds() - StartTime >= BudgetSeconds) break;
 	}
+
+	return Plan.ApplyHism >= Plan.HismTransforms.Num();
 }
 
 void AAGlobalCrowdManager::BakeCrowd()
 {
+	LLM_SCOPE_BYTAG(Stands);
+
+	// a sync bake wins over a running async one
+	CancelCrowdBake();
+
 	// 1. 
 	ClearCrowd();
 
 	// 2. 
 	SetupHISMComponents();
 
-	// 3. expensive search
-	const TArray<FTransform> FilteredSeats = GetFilteredSeatTransforms();
+	// 3. expensive search. apply pending spawner changes first
+	if (SeatManager)
+	{
+		SeatManager->FlushSeatUpdates();
+	}
+	FCrowdBakePlan Plan;
+	BuildBakeContext(Plan.Context);
+	ResetDeltaBookkeeping(Plan.Context);
+	BuildBakePlan(Plan);
 
 	// 4. fillup hisms
-	PopulateHISMs(FilteredSeats);
+	ApplyBakePlan(Plan, DBL_MAX, MAX_int32);
+
+	StandsStats::UpdateCrowdCounters(ReportedCounters, Plan.Context.Volumes.Num(), Plan.NumInstances, CrowdHISMs.Num());
+	UE_LOG(LogTemp, Log, TEXT("Crowd Baked %d instances"), Plan.NumInstances);
+}
+
+void AAGlobalCrowdManager::BakeAndFreeze()
+{
+	UStandsBakedData* BakedData = SeatManager ? SeatManager->GetBakedData() : nullptr;
+	if (!BakedData)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: BakeAndFreeze needs BakedData on the seat manager"), *GetName());
+		return;
+	}
+	if (SeatManager->IsSeatLayoutFrozen())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: seats are already frozen, nothing new to bake"), *GetName());
+		return;
+	}
+
+	// fills the HISMs and the back map from the current seats
+	BakeCrowd();
+
+	const FSeatLayoutRef Seats = SeatManager->GetSeatLayout();
+	if (SeatInstanceSlots.Num() != Seats->Num() || HismInstanceSeats.Num() != CrowdHISMs.Num())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: seats changed during the bake, nothing frozen"), *GetName());
+		return;
+	}
 
-	UE_LOG(LogTemp, Log, TEXT("Crowd Baked %d instances"), FilteredSeats.Num());
+	TArray<TSoftObjectPtr<AActor>> Spawners;
+	for (const TWeakObjectPtr<AActor>& Spawner : SeatManager->GetSeatLayoutSpawners())
+	{
+		Spawners.Add(TSoftObjectPtr<AActor>(Spawner.Get()));
+	}
+
+	// custom data as the HISMs hold it, instance order matches HismInstanceSeats
+	TArray<TArray<float>> HismCustomData;
+	HismCustomData.SetNum(CrowdHISMs.Num());
+	for (int32 HismIdx = 0; HismIdx < CrowdHISMs.Num(); ++HismIdx)
+	{
+		if (CrowdHISMs[HismIdx])
+		{
+			HismCustomData[HismIdx] = CrowdHISMs[HismIdx]->PerInstanceSMCustomData;
+		}
+	}
+
+	const int32 NumFloats = bSingleHISMPerMesh ? CrowdCustomData::NumSingleHISM : CrowdCustomData::NumPerClipHISM;
+	BakedData->Store(*Seats, Spawners, HismInstanceSeats, HismCustomData, NumFloats, SeatManager->HashLevelSeats(), HashCrowdSettings());
+
+	UE_LOG(LogTemp, Log, TEXT("Crowd frozen into %s: %d seats, %d instances, %.1f KB"),
+		*BakedData->GetName(), BakedData->NumSeats, BakedData->NumCrowdInstances, BakedData->PayloadBytes / 1024.0);
 }
 
-int32 AAGlobalCrowdManager::PickMIByWeight() const
+bool AAGlobalCrowdManager::ApplyBakedData()
 {
-	// mi slots
-	const int32 NumMats = (CrowdCharacterVariants.Num() > 0)
-		? CrowdCharacterVariants[0].VATMats.Num()
-		: 0;
+	STANDS_SCOPE(STAT_Stands_LoadBakedData);
 
-	// 2. weight slots
-	const int32 NumWeights = MaterialWeights.GetNumWeights();
+	UStandsBakedData* BakedData = SeatManager ? SeatManager->GetBakedData() : nullptr;
+	const TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> BakedSeats = BakedData ? BakedData->GetSeatLayout() : nullptr;
+	if (!BakedSeats.IsValid() || !BakedData->HasCrowd()) return false;
 
-	// 3. get min one
-	const int32 NumOptions = FMath::Min(NumMats, NumWeights);
+	// seats or settings changed since the bake, keep the crowd saved with the level
+	if (!HasCurrentBakedData())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: %s is older than the level's seats or crowd settings, bake it again"), *GetName(), *BakedData->GetName());
+		return false;
+	}
 
-	if (NumOptions == 0)
+	// everything checked against the baked data before the saved crowd goes. variants changed since the bake
+	const int32 NumHISMs = GetNumHISMsNeeded();
+	const int32 NumFloats = bSingleHISMPerMesh ? CrowdCustomData::NumSingleHISM : CrowdCustomData::NumPerClipHISM;
+	if (BakedData->GetNumCrowdHISMs() != NumHISMs || BakedData->GetNumCustomDataFloats() != NumFloats)
 	{
-		return -1;
+		UE_LOG(LogTemp, Warning, TEXT("%s: %s was baked for other crowd variants, bake it again"), *GetName(), *BakedData->GetName());
+		return false;
 	}
 
-	// 4. sum
-	float sum = 0.0f;
-	for (int32 i = 0; i < NumOptions; ++i)
-		sum += MaterialWeights.GetWeightByIndex(i);
+	// every member on a seat of its own, custom data for each
+	const FSeatLayout& Layout = *BakedSeats;
+	TBitArray<> Taken(false, Layout.Num());
+	for (int32 HismIdx = 0; HismIdx < NumHISMs; ++HismIdx)
+	{
+		const TArray<int32>& Seats = BakedData->GetHismSeats(HismIdx);
+		bool bIsValid = BakedData->GetHismCustomData(HismIdx).Num() == Seats.Num() * NumFloats;
+		for (const int32 SeatIdx : Seats)
+		{
+			bIsValid &= Layout.Positions.IsValidIndex(SeatIdx) && !Taken[SeatIdx];
+			if (!bIsValid) break;
+			Taken[SeatIdx] = true;
+		}
+		if (!bIsValid)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: %s has members that don't fit its seats, bake it again"), *GetName(), *BakedData->GetName());
+			return false;
+		}
+	}
 
-	if (sum <= 0.0f)
-		return FMath::RandRange(0, NumOptions - 1); // then pure random
+	const double StartTime = FPlatformTime::Seconds();
+	CancelCrowdBake();
+	ClearCrowd();
+	SetupHISMComponents();
 
-	// 5. pick by weight
-	float Roll = FMath::FRand() * sum;
+	// bookkeeping against the baked seats, the seat manager publishes the same ones
+	FCrowdBakeContext Context;
+	BuildBakeContext(Context);
+	Context.Seats = BakedSeats;
+	ResetDeltaBookkeeping(Context);
 
-	// 6. find the domain
-	float CurrentWeightSum = 0.0f;
-	for (int32 i = 0; i < NumOptions; ++i)
+	// straight upload, transforms are the only thing left to compute
+	int32 NumInstances = 0;
+	TArray<FTransform> Transforms;
+	for (int32 HismIdx = 0; HismIdx < CrowdHISMs.Num(); ++HismIdx)
 	{
-		CurrentWeightSum += MaterialWeights.GetWeightByIndex(i);
-		if (Roll < CurrentWeightSum)
+		UHierarchicalInstancedStaticMeshComponent* HISM = CrowdHISMs[HismIdx];
+		const TArray<int32>& Seats = BakedData->GetHismSeats(HismIdx);
+		if (!HISM || Seats.Num() == 0) continue;
+
+		Transforms.SetNumUninitialized(Seats.Num());
+		ParallelFor(Seats.Num(), [this, &Transforms, &Layout, &Seats](int32 i)
+		{
+			Transforms[i] = OffsetTransform * Layout.GetTransform(Seats[i]);
+		});
+		AddInstancesWithCustomData(HISM, Transforms, BakedData->GetHismCustomData(HismIdx));
+		HISM->BuildTreeIfOutdated(true, false);
+
+		for (int32 k = 0; k < Seats.Num(); ++k)
 		{
-			return i; // found
+			SeatInstanceSlots[Seats[k]] = FIntPoint(HismIdx, k);
 		}
+		HismInstanceSeats[HismIdx] = Seats;
+		NumInstances += Seats.Num();
 	}
 
-	return NumOptions - 1;
+	StandsStats::UpdateCrowdCounters(ReportedCounters, Context.Volumes.Num(), NumInstances, CrowdHISMs.Num());
+	UE_LOG(LogTemp, Log, TEXT("Crowd loaded from %s: %d instances in %.2f ms"), *BakedData->GetName(), NumInstances, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
 }
 
-// Called when the game starts or when spawned
-void AAGlobalCrowdManager::BeginPlay()
+bool AAGlobalCrowdManager::HasCurrentBakedData() const
 {
-	Super::BeginPlay();
-	
+	const UStandsBakedData* BakedData = SeatManager ? SeatManager->GetBakedData() : nullptr;
+	return BakedData && BakedData->HasCrowd() && SeatManager->HasCurrentBakedData() && BakedData->CrowdSettingsHash == HashCrowdSettings();
 }
 
-// Called every frame
-void AAGlobalCrowdManager::Tick(float DeltaTime)
+void AAGlobalCrowdManager::BakeCrowdAsync()
 {
-	Super::Tick(DeltaTime);
+	LLM_SCOPE_BYTAG(Stands);
+
+	// newest request wins
+	CancelCrowdBake();
+
+	// game thread part: components, seats, volumes, bookkeeping
+	ClearCrowd();
+	SetupHISMComponents();
+	if (SeatManager)
+	{
+		SeatManager->FlushSeatUpdates();
+	}
+
+	const TSharedRef<FCrowdBakePlan, ESPMode::ThreadSafe> Plan = MakeShared<FCrowdBakePlan, ESPMode::ThreadSafe>();
+	BuildBakeContext(Plan->Context);
+	ResetDeltaBookkeeping(Plan->Context);
+	Plan->Serial = ++AsyncBakeSerial;
+	Plan->StartTime = FPlatformTime::Seconds();
+	AsyncBake = Plan;
+
+	// filter and picks only read the context
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Plan]()
+	{
+		BuildBakePlan(*Plan);
+		Plan->bPlanReady = true;
+	});
+
+	// instances go in on the game thread, a budget per frame
+	AsyncBakeTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &AAGlobalCrowdManager::TickAsyncBake));
+}
+
+bool AAGlobalCrowdManager::TickAsyncBake(float DeltaTime)
+{
+	if (!AsyncBake.IsValid())
+	{
+		AsyncBakeTickerHandle.Reset();
+		return false;
+	}
+
+	// worker still filtering
+	FCrowdBakePlan& Plan = *AsyncBake;
+	if (!Plan.bPlanReady) return true;
+
+	if (!ApplyBakePlan(Plan, AsyncBakeBudgetMs / 1000.0, AsyncBakeBatchSize)) return true;
+
+	StandsStats::UpdateCrowdCounters(ReportedCounters, Plan.Context.Volumes.Num(), Plan.NumInstances, CrowdHISMs.Num());
+	UE_LOG(LogTemp, Log, TEXT("Crowd async baked %d instances in %.2f ms"), Plan.NumInstances, (FPlatformTime::Seconds() - Plan.StartTime) * 1000.0);
+
+	CompletedBakeSerial = Plan.Serial;
+	AsyncBake.Reset();
+	AsyncBakeTickerHandle.Reset();
+	return false;
+}
+
+void AAGlobalCrowdManager::CancelCrowdBake()
+{
+	if (AsyncBake.IsValid())
+	{
+		// the worker sees this at its next check and drops out
+		AsyncBake->bCancelled = true;
+		AsyncBake.Reset();
+	}
+
+	if (AsyncBakeTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(AsyncBakeTickerHandle);
+		AsyncBakeTickerHandle.Reset();
+	}
+}
+
+int32 AAGlobalCrowdManager::GetNumCrowdInstances() const
+{
+	// some are in the LOD pools or culled
+	if (LodSeats.IsValid()) return LodNumMembers;
+
+	int32 NumInstances = 0;
+	for (const UHierarchicalInstancedStaticMeshComponent* HISM : CrowdHISMs)
+	{
+		NumInstances += HISM ? HISM->GetInstanceCount() : 0;
+	}
+	return NumInstances;
+}
+
+float AAGlobalCrowdManager::GetCrowdBakeProgress() const
+{
+	return AsyncBake.IsValid() ? AsyncBake->GetProgress() : 1.0f;
+}
+
+void AAGlobalCrowdManager::BakeCrowdLatent(FLatentActionInfo LatentInfo, ECrowdBakeLatentResult& Result, float& Progress)
+{
+	UWorld* World = GetWorld();
+	if (!World) return;
+
+	// node already waiting on a bake
+	FLatentActionManager& LatentManager = World->GetLatentActionManager();
+	if (LatentManager.FindExistingAction<FCrowdBakeLatentAction>(LatentInfo.CallbackTarget, LatentInfo.UUID))
+	{
+		return;
+	}
+
+	BakeCrowdAsync();
+
+	Progress = 0.0f;
+	Result = ECrowdBakeLatentResult::Progress;
+	LatentManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID, new FCrowdBakeLatentAction(this, AsyncBakeSerial, LatentInfo, Result, Progress));
+}
+
+void AAGlobalCrowdManager::ResetDeltaBookkeeping(const FCrowdBakeContext& Context)
+{
+	const int32 NumSeats = Context.Seats->Num();
+	SeatInstanceSlots.Init(FIntPoint(INDEX_NONE, INDEX_NONE), NumSeats);
+
+	HismInstanceSeats.Reset();
+	HismInstanceSeats.SetNum(CrowdHISMs.Num());
+
+	BakedSeatLayoutVersion = Context.Seats->Version;
+	BakedSeatLayoutHash = HashSeatLayout(*Context.Seats);
+	BakedSettingsHash = HashCrowdSettings();
+
+	BakedVolumeBoxes.Reset();
+	for (int32 VolumeIdx = 0; VolumeIdx < Context.Volumes.Num(); ++VolumeIdx)
+	{
+		if (Context.Volumes[VolumeIdx])
+		{
+			BakedVolumeBoxes.Add(Context.Volumes[VolumeIdx], Context.VolumeBoxes[VolumeIdx]);
+		}
+	}
+}
+
+uint32 AAGlobalCrowdManager::HashSeatLayout(const FSeatLayout& Seats)
+{
+	uint32 Crc = FCrc::MemCrc32(Seats.Positions.GetData(), Seats.Positions.Num() * sizeof(FVector3f), Seats.Num());
+	Crc = FCrc::MemCrc32(Seats.Yaws.GetData(), Seats.Yaws.Num() * sizeof(uint16), Crc);
+	Crc = FCrc::MemCrc32(Seats.SpawnerIds.GetData(), Seats.SpawnerIds.Num() * sizeof(uint16), Crc);
+
+	// components, not the FTransform bytes (padding)
+	for (const FTransform& SpawnerTransform : Seats.SpawnerTransforms)
+	{
+		const FVector Location = SpawnerTransform.GetLocation();
+		const FQuat Rotation = SpawnerTransform.GetRotation();
+		Crc = FCrc::MemCrc32(&Location, sizeof(FVector), Crc);
+		Crc = FCrc::MemCrc32(&Rotation, sizeof(FQuat), Crc);
+	}
+	Crc = FCrc::MemCrc32(&Seats.SeatRotation, sizeof(FRotator), Crc);
+	return FCrc::MemCrc32(&Seats.SeatScale, sizeof(FVector), Crc);
+}
+
+uint32 AAGlobalCrowdManager::HashCrowdSettings() const
+{
+	const FVector Location = OffsetTransform.GetLocation();
+	const FQuat Rotation = OffsetTransform.GetRotation();
+	const FVector Scale = OffsetTransform.GetScale3D();
+	uint32 Crc = FCrc::MemCrc32(&Location, sizeof(FVector), CrowdRandomSeed);
+	Crc = FCrc::MemCrc32(&Rotation, sizeof(FQuat), Crc);
+	Crc = FCrc::MemCrc32(&Scale, sizeof(FVector), Crc);
+
+	const float Weights[] = { MaterialWeights.WaveHand, MaterialWeights.ClapHigh, MaterialWeights.Clap, MaterialWeights.Upset, MaterialWeights.Idle, MaterialWeights.Yell };
+	Crc = FCrc::MemCrc32(Weights, sizeof(Weights), Crc);
+	Crc = FCrc::MemCrc32(MaterialWeights.AdditionalWeights.GetData(), MaterialWeights.AdditionalWeights.Num() * sizeof(float), Crc);
+
+	// assets by path, the hash is saved with the level
+	Crc = HashCombine(Crc, GetTypeHash(bSingleHISMPerMesh));
+	for (const FCharacterVariant& Variant : CrowdCharacterVariants)
+	{
+		Crc = FCrc::StrCrc32(*GetPathNameSafe(Variant.Mesh), Crc);
+		Crc = FCrc::StrCrc32(*GetPathNameSafe(Variant.ClipArrayMat), Crc);
+		for (const UMaterialInterface* Mat : Variant.VATMats)
+		{
+			Crc = FCrc::StrCrc32(*GetPathNameSafe(Mat), Crc);
+		}
+	}
+	return HashCombine(Crc, GetTypeHash(CrowdCharacterVariants.Num()));
+}
+
+bool AAGlobalCrowdManager::IsDeltaBookkeepingValid(const FSeatLayout& Layout) const
+{
+	// half applied async bake -> full bake
+	if (!SeatManager || AsyncBake.IsValid()) return false;
+
+	// manager settings changed since the bake, old instances would stay under the old picks
+	if (HashCrowdSettings() != BakedSettingsHash) return false;
+
+	if (SeatInstanceSlots.Num() != Layout.Num() || HismInstanceSeats.Num() != CrowdHISMs.Num())
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < CrowdHISMs.Num(); ++i)
+	{
+		if (!CrowdHISMs[i] || CrowdHISMs[i]->GetInstanceCount() != HismInstanceSeats[i].Num())
+		{
+			return false;
+		}
+	}
+
+	// same snapshot as the last bake, nothing to hash
+	if (Layout.Version == BakedSeatLayoutVersion) return true;
+
+	// rebuilt since, but maybe to the same seats (spawner re-registered unchanged)
+	return HashSeatLayout(Layout) == BakedSeatLayoutHash;
+}
+
+void AAGlobalCrowdManager::RebakeVolume(AACrowdVolume* Volume)
+{
+	STANDS_SCOPE(STAT_Stands_RebakeVolume);
+
+	if (!Volume || !SeatManager) return;
+
+	// the delta patches the crowd HISMs, every member has to be in them
+	RestoreCrowdLod();
+
+	SeatManager->FlushSeatUpdates();
+
+	FCrowdBakeContext Context;
+	BuildBakeContext(Context);
+
+	// first bake, seats or HISMs changed under us -> nothing to patch. a loaded crowd gets its bookkeeping back first
+	if (!RestoreDeltaBookkeeping())
+	{
+		BakeCrowd();
+		return;
+	}
+	BakedSeatLayoutVersion = Context.Seats->Version;
+
+	// only seats in the union of where the volume was and where it is now can change
+	const FBox* OldBoxPtr = BakedVolumeBoxes.Find(Volume);
+	const FBox OldBox = OldBoxPtr ? *OldBoxPtr : FBox(ForceInit);
+	const FBox NewBox = Volume->GetQueryBox();
+
+	const FSeatLayout& Layout = *Context.Seats;
+	const int32 TotalHISMs = CrowdHISMs.Num();
+
+	TArray<int32> SeatsToRemove;
+	TArray<TArray<FTransform>> AddTransforms;
+	TArray<TArray<float>> AddCustomData;
+	TArray<TArray<int32>> AddSeats;
+	AddTransforms.SetNum(TotalHISMs);
+	AddCustomData.SetNum(TotalHISMs);
+	AddSeats.SetNum(TotalHISMs);
+	TBitArray<> TouchedHISMs(false, TotalHISMs);
+
+	// spawners whose seats the old or new box touches, ascending
+	UpdateSeatRunGrid(Layout);
+	TBitArray<> RunHits;
+	SeatRunGrid.FindOverlapping(OldBox, RunHits);
+	SeatRunGrid.FindOverlapping(NewBox, RunHits);
+
+	int32 NumChecked = 0;
+	int32 NumClipChanges = 0;
+	for (TConstSetBitIterator<> RunIt(RunHits); RunIt; ++RunIt)
+	{
+		const FIntPoint Run = SeatRuns[RunIt.GetIndex()];
+		for (int32 SeatIdx = Run.X; SeatIdx < Run.X + Run.Y; ++SeatIdx)
+		{
+			const FVector SeatLocation = Layout.GetLocation(SeatIdx);
+			if (!(OldBox.IsValid && OldBox.IsInsideOrOn(SeatLocation)) && !(NewBox.IsValid && NewBox.IsInsideOrOn(SeatLocation)))
+			{
+				continue;
+			}
+			++NumChecked;
+
+			// same rules as the full bake
+			int32 NewHism = INDEX_NONE;
+			float TimeOffset = 0.0f;
+			int32 ClipIdx = 0;
+			const int32 VolumeIdx = FindSeatVolume(Context, SeatLocation);
+			if (VolumeIdx != INDEX_NONE && Context.NumMats > 0)
+			{
+				NewHism = PickSeatHISM(Context, SeatLocation, VolumeIdx, TimeOffset, ClipIdx);
+			}
+
+			// picks are per seat deterministic, same HISM = same instance
+			const int32 OldHism = SeatInstanceSlots[SeatIdx].X;
+			if (OldHism == NewHism)
+			{
+				// only the clip can differ (new weights), one custom data write
+				if (Context.bClipInCustomData && OldHism != INDEX_NONE && SetInstanceClip(OldHism, SeatInstanceSlots[SeatIdx].Y, ClipIdx, false))
+				{
+					++NumClipChanges;
+					TouchedHISMs[OldHism] = true;
+				}
+				continue;
+			}
+
+			if (OldHism != INDEX_NONE)
+			{
+				SeatsToRemove.Add(SeatIdx);
+			}
+			if (NewHism != INDEX_NONE && NewHism < TotalHISMs)
+			{
+				AddTransforms[NewHism].Add(Context.InstanceOffset * Layout.GetTransform(SeatIdx));
+				AddCustomData[NewHism].Add(TimeOffset);
+				if (Context.bClipInCustomData)
+				{
+					AddCustomData[NewHism].Add(static_cast<float>(ClipIdx));
+				}
+				AddSeats[NewHism].Add(SeatIdx);
+			}
+		}
+	}
+
+	// 1. remove, one RemoveInstances per HISM. untouched instances keep their data
+	RemoveSeatInstances(SeatsToRemove, CrowdHISMs, SeatInstanceSlots, HismInstanceSeats, TouchedHISMs);
+
+	// 2. append
+	int32 NumAdded = 0;
+	for (int32 i = 0; i < TotalHISMs; ++i)
+	{
+		if (AddSeats[i].Num() == 0) continue;
+
+		AddSeatInstances(AddSeats[i], CrowdHISMs[i], i, AddTransforms[i], AddCustomData[i], SeatInstanceSlots, HismInstanceSeats[i]);
+		TouchedHISMs[i] = true;
+		NumAdded += AddSeats[i].Num();
+	}
+
+	// one instance update per changed HISM, and those rebuild their tree async
+	for (TConstSetBitIterator<> It(TouchedHISMs); It; ++It)
+	{
+		CrowdHISMs[It.GetIndex()]->MarkRenderInstancesDirty();
+		CrowdHISMs[It.GetIndex()]->BuildTreeIfOutdated(true, false);
+	}
+
+	BakedVolumeBoxes.Add(Volume, NewBox);
+	StandsStats::UpdateCrowdCounters(ReportedCounters, Context.Volumes.Num(), GetNumCrowdInstances(), CrowdHISMs.Num());
+
+	UE_LOG(LogTemp, Log, TEXT("Crowd delta baked %s: %d seats checked, -%d +%d instances, %d clip changes"),
+		*Volume->GetName(), NumChecked, SeatsToRemove.Num(), NumAdded, NumClipChanges);
+}
+
+void AAGlobalCrowdManager::UpdateSeatRunGrid(const FSeatLayout& Layout)
+{
+	if (Layout.Version == SeatRunGridVersion) return;
+	SeatRunGridVersion = Layout.Version;
+
+	SeatRuns.Reset();
+	TArray<FBox> RunBoxes;
+	for (int32 SeatIdx = 0; SeatIdx < Layout.Num(); ++SeatIdx)
+	{
+		if (SeatRuns.Num() == 0 || Layout.SpawnerIds[SeatIdx] != Layout.SpawnerIds[SeatIdx - 1])
+		{
+			SeatRuns.Add(FIntPoint(SeatIdx, 0));
+			RunBoxes.Add(FBox(ForceInit));
+		}
+		++SeatRuns.Last().Y;
+		RunBoxes.Last() += Layout.GetLocation(SeatIdx);
+	}
+	SeatRunGrid.Build(RunBoxes);
+}
+
+bool AAGlobalCrowdManager::SetInstanceClip(int32 HismIdx, int32 InstanceIdx, int32 ClipIdx, bool bMarkRenderStateDirty)
+{
+	UHierarchicalInstancedStaticMeshComponent* HISM = CrowdHISMs.IsValidIndex(HismIdx) ? CrowdHISMs[HismIdx] : nullptr;
+	if (!HISM || HISM->NumCustomDataFloats <= CrowdCustomData::ClipIndex) return false;
+	if (!HISM->PerInstanceSMCustomData.IsValidIndex(InstanceIdx * HISM->NumCustomDataFloats + CrowdCustomData::ClipIndex)) return false;
+
+	const float ClipValue = static_cast<float>(ClipIdx);
+	if (HISM->PerInstanceSMCustomData[InstanceIdx * HISM->NumCustomDataFloats + CrowdCustomData::ClipIndex] == ClipValue) return false;
+
+	return HISM->SetCustomDataValue(InstanceIdx, CrowdCustomData::ClipIndex, ClipValue, bMarkRenderStateDirty);
+}
+
+int32 AAGlobalCrowdManager::GetHismNumClips(int32 HismIdx) const
+{
+	const int32 NumMatsPerVariant = CrowdCharacterVariants.Num() > 0 ? CrowdCharacterVariants[0].VATMats.Num() : 0;
+	const int32 VariantIdx = bSingleHISMPerMesh ? HismIdx : HismIdx / FMath::Max(NumMatsPerVariant, 1);
+	return CrowdCharacterVariants.IsValidIndex(VariantIdx) ? CrowdCharacterVariants[VariantIdx].VATMats.Num() : 0;
+}
+
+bool AAGlobalCrowdManager::SetCrowdMemberClip(int32 SeatIndex, int32 ClipIndex)
+{
+	if (!bSingleHISMPerMesh) return false;
+
+	// nothing baked this session (loaded level, PIE): find the instances first
+	if (SeatInstanceSlots.Num() == 0 || HismInstanceSeats.Num() != CrowdHISMs.Num())
+	{
+		RestoreDeltaBookkeeping();
+	}
+	if (!SeatInstanceSlots.IsValidIndex(SeatIndex)) return false;
+
+	const FIntPoint Slot = SeatInstanceSlots[SeatIndex];
+	if (Slot.X == INDEX_NONE)
+	{
+		// out in a LOD tier, takes the clip on the way back
+		if (LodSeats.IsValid() && LodSeatHism.IsValidIndex(SeatIndex) && LodSeatHism[SeatIndex] != INDEX_NONE && LodNumCustomData > CrowdCustomData::ClipIndex)
+		{
+			if (ClipIndex < 0 || ClipIndex >= GetHismNumClips(LodSeatHism[SeatIndex])) return false;
+
+			LodSeatCustomData[SeatIndex * LodNumCustomData + CrowdCustomData::ClipIndex] = static_cast<float>(ClipIndex);
+			return true;
+		}
+		return false; // empty seat
+	}
+
+	// past the clip array the material samples garbage
+	if (ClipIndex < 0 || ClipIndex >= GetHismNumClips(Slot.X)) return false;
+
+	// one float, the custom data write dirties what it needs
+	return SetInstanceClip(Slot.X, Slot.Y, ClipIndex, true);
+}
+
+// instance and seat location key, 1 mm
+static FIntVector GetLocationKey(const FVector& Location)
+{
+	return FIntVector(FMath::RoundToInt32(Location.X * 10.0), FMath::RoundToInt32(Location.Y * 10.0), FMath::RoundToInt32(Location.Z * 10.0));
+}
+
+bool AAGlobalCrowdManager::RestoreDeltaBookkeeping()
+{
+	if (!SeatManager || AsyncBake.IsValid()) return false;
+
+	FCrowdBakeContext Context;
+	BuildBakeContext(Context);
+	const FSeatLayout& Layout = *Context.Seats;
+	if (IsDeltaBookkeepingValid(Layout)) return true;
+
+	// baked this session and stale since, only a bake fixes that
+	if (SeatInstanceSlots.Num() > 0) return false;
+
+	// tried these seats already
+	if (Layout.Num() == 0 || Layout.Version == FailedRestoreLayoutVersion) return false;
+	FailedRestoreLayoutVersion = Layout.Version;
+
+	// instances saved under other settings can't be patched, bake again
+	if (HashCrowdSettings() != BakedSettingsHash)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: crowd settings changed since the last bake, bake the crowd again for delta bakes, clip changes and LOD"), *GetName());
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// seat by where its member stands, the bake's own transform
+	TMap<FIntVector, int32> SeatByLocation;
+	SeatByLocation.Reserve(Layout.Num());
+	for (int32 SeatIdx = 0; SeatIdx < Layout.Num(); ++SeatIdx)
+	{
+		SeatByLocation.Add(GetLocationKey((OffsetTransform * Layout.GetTransform(SeatIdx)).GetLocation()), SeatIdx);
+	}
+
+	// volume boxes as they are now, the crowd was saved with them
+	ResetDeltaBookkeeping(Context);
+
+	int32 NumInstances = 0;
+	for (int32 HismIdx = 0; HismIdx < CrowdHISMs.Num(); ++HismIdx)
+	{
+		const UHierarchicalInstancedStaticMeshComponent* HISM = CrowdHISMs[HismIdx];
+		const int32 Count = HISM ? HISM->GetInstanceCount() : 0;
+		TArray<int32>& InstanceSeats = HismInstanceSeats[HismIdx];
+		InstanceSeats.SetNumUninitialized(Count);
+
+		for (int32 InstanceIdx = 0; InstanceIdx < Count; ++InstanceIdx)
+		{
+			FTransform InstanceTransform;
+			HISM->GetInstanceTransform(InstanceIdx, InstanceTransform, false);
+			const int32* SeatIdx = SeatByLocation.Find(GetLocationKey(InstanceTransform.GetLocation()));
+
+			// seats moved since the save, or two members on one seat
+			if (!SeatIdx || SeatInstanceSlots[*SeatIdx].X != INDEX_NONE)
+			{
+				SeatInstanceSlots.Reset();
+				HismInstanceSeats.Reset();
+				UE_LOG(LogTemp, Warning, TEXT("%s: saved crowd instances don't match the seats, bake the crowd again for delta bakes, clip changes and LOD"), *GetName());
+				return false;
+			}
+
+			InstanceSeats[InstanceIdx] = *SeatIdx;
+			SeatInstanceSlots[*SeatIdx] = FIntPoint(HismIdx, InstanceIdx);
+		}
+		NumInstances += Count;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Crowd bookkeeping restored from the level: %d instances on %d seats in %.2f ms"),
+		NumInstances, Layout.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+void AAGlobalCrowdManager::SetCrowdLodEnabled(bool bEnabled)
+{
+	bEnableCrowdLod = bEnabled;
+	if (!bEnabled)
+	{
+		RestoreCrowdLod();
+	}
+
+	LodNextUpdateTime = 0.0;
+	UpdateTickEnabled();
+}
+
+ECrowdLodTier AAGlobalCrowdManager::GetSeatLodTier(int32 SeatIndex) const
+{
+	// no LOD, or an empty seat
+	if (!LodSeats.IsValid() || !LodSeatHism.IsValidIndex(SeatIndex) || LodSeatHism[SeatIndex] == INDEX_NONE) return ECrowdLodTier::Full;
+	if (SeatInstanceSlots[SeatIndex].X != INDEX_NONE) return ECrowdLodTier::Full;
+
+	// pooled Frozen, pooled Far, or culled Far
+	const int32 Pool = LodSeatSlots[SeatIndex].X;
+	return Pool != INDEX_NONE && Pool < CrowdCharacterVariants.Num() ? ECrowdLodTier::Frozen : ECrowdLodTier::Far;
+}
+
+bool AAGlobalCrowdManager::InitCrowdLod()
+{
+	STANDS_SCOPE(STAT_Stands_CrowdLod);
+
+	if (!SeatManager) return false;
+
+	// loaded level: bookkeeping from the saved instances. half baked or stale crowd, try again next update
+	const FSeatLayoutRef Seats = SeatManager->GetSeatLayout();
+	if (Seats->Version == LodFailedLayoutVersion) return false;
+	if (!RestoreDeltaBookkeeping())
+	{
+		// a bake in flight ends with valid bookkeeping
+		if (!AsyncBake.IsValid() && Seats->Num() > 0)
+		{
+			LodFailedLayoutVersion = Seats->Version;
+			UE_LOG(LogTemp, Warning, TEXT("%s: crowd instances don't match the bake bookkeeping, crowd LOD is off until the crowd is baked again"), *GetName());
+		}
+		return false;
+	}
+
+	const int32 NumSeats = Seats->Num();
+	LodNumCustomData = bSingleHISMPerMesh ? CrowdCustomData::NumSingleHISM : CrowdCustomData::NumPerClipHISM;
+	LodNumMatsPerVariant = CrowdCharacterVariants.Num() > 0 ? CrowdCharacterVariants[0].VATMats.Num() : 0;
+	LodSeatHism.Init(INDEX_NONE, NumSeats);
+	LodSeatCustomData.SetNumZeroed(NumSeats * LodNumCustomData);
+	LodSeatSlots.Init(FIntPoint(INDEX_NONE, INDEX_NONE), NumSeats);
+	LodNumMembers = 0;
+
+	// home HISM and custom data of every member, it is all the way back to Full needs
+	for (int32 HismIdx = 0; HismIdx < CrowdHISMs.Num(); ++HismIdx)
+	{
+		const UHierarchicalInstancedStaticMeshComponent* HISM = CrowdHISMs[HismIdx];
+		const TArray<int32>& InstanceSeats = HismInstanceSeats[HismIdx];
+		const bool bHasCustomData = HISM->NumCustomDataFloats == LodNumCustomData
+			&& HISM->PerInstanceSMCustomData.Num() == InstanceSeats.Num() * LodNumCustomData;
+
+		for (int32 k = 0; k < InstanceSeats.Num(); ++k)
+		{
+			const int32 SeatIdx = InstanceSeats[k];
+			LodSeatHism[SeatIdx] = static_cast<int16>(HismIdx);
+			if (bHasCustomData)
+			{
+				FMemory::Memcpy(&LodSeatCustomData[SeatIdx * LodNumCustomData], &HISM->PerInstanceSMCustomData[k * LodNumCustomData], LodNumCustomData * sizeof(float));
+			}
+		}
+		LodNumMembers += InstanceSeats.Num();
+	}
+	if (LodNumMembers == 0) return false;
+
+	// a section per seat spawner, their seats are contiguous
+	LodSections.Reset();
+	for (int32 SeatIdx = 0; SeatIdx < NumSeats; ++SeatIdx)
+	{
+		if (LodSections.Num() == 0 || Seats->SpawnerIds[SeatIdx] != Seats->SpawnerIds[SeatIdx - 1])
+		{
+			LodSections.AddDefaulted_GetRef().FirstSeat = SeatIdx;
+		}
+
+		FCrowdLodSection& Section = LodSections.Last();
+		++Section.NumSeats;
+		if (LodSeatHism[SeatIdx] != INDEX_NONE)
+		{
+			++Section.NumMembers;
+			Section.Bounds += OffsetTransform.TransformPosition(Seats->GetLocation(SeatIdx));
+		}
+	}
+
+	SetupLodPools();
+	LodSeats = Seats;
+
+	UE_LOG(LogTemp, Log, TEXT("Crowd LOD: %d members in %d sections, %d pools"), LodNumMembers, LodSections.Num(), LodPoolHISMs.Num());
+	return true;
+}
+
+void AAGlobalCrowdManager::SetupLodPools()
+{
+	const int32 NumVariants = CrowdCharacterVariants.Num();
+	const int32 NumPools = NumVariants * 2;
+
+	bool bIsPoolsInvalid = LodPoolHISMs.Num() != NumPools;
+	for (const UHierarchicalInstancedStaticMeshComponent* Pool : LodPoolHISMs)
+	{
+		bIsPoolsInvalid |= !Pool;
+	}
+
+	if (bIsPoolsInvalid)
+	{
+		for (UHierarchicalInstancedStaticMeshComponent* Pool : LodPoolHISMs)
+		{
+			if (Pool && Pool->IsValidLowLevel())
+			{
+				Pool->DestroyComponent();
+			}
+		}
+		LodPoolHISMs.Empty(NumPools);
+
+		for (int32 i = 0; i < NumPools; ++i)
+		{
+			FName PoolName = FName(*FString::Printf(TEXT("CrowdLodHISM_%d"), i));
+			UHierarchicalInstancedStaticMeshComponent* NewPool = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, PoolName, RF_Transient);
+			NewPool->SetupAttachment(HISMsRoot);
+			NewPool->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			NewPool->bSelectable = false;
+			NewPool->bAutoRebuildTreeOnInstanceChanges = false;
+			NewPool->RegisterComponent();
+			LodPoolHISMs.Add(NewPool);
+		}
+	}
+
+	for (int32 PoolIdx = 0; PoolIdx < NumPools; ++PoolIdx)
+	{
+		UHierarchicalInstancedStaticMeshComponent* Pool = LodPoolHISMs[PoolIdx];
+		const FCharacterVariant& Variant = CrowdCharacterVariants[PoolIdx % NumVariants];
+		const bool bFar = PoolIdx >= NumVariants;
+
+		Pool->ClearInstances();
+		// time offset only, frozen materials can still vary per member
+		Pool->SetNumCustomDataFloats(CrowdCustomData::NumPerClipHISM);
+		Pool->SetStaticMesh(Variant.FrozenMesh ? Variant.FrozenMesh : Variant.Mesh);
+		Pool->EmptyOverrideMaterials();
+		if (Variant.FrozenMat)
+		{
+			for (int32 MatIdx = 0; MatIdx < Pool->GetNumMaterials(); ++MatIdx)
+			{
+				Pool->SetMaterial(MatIdx, Variant.FrozenMat);
+			}
+		}
+
+		// no VAT out here: no WPO, and no shadows past the far distance
+		Pool->SetEvaluateWorldPositionOffset(false);
+		Pool->SetCastShadow(!bFar);
+	}
+
+	LodPoolInstanceSeats.Reset();
+	LodPoolInstanceSeats.SetNum(NumPools);
+}
+
+void AAGlobalCrowdManager::ResetCrowdLod()
+{
+	LodSeats.Reset();
+	LodSections.Reset();
+	LodSeatHism.Reset();
+	LodSeatCustomData.Reset();
+	LodSeatSlots.Reset();
+	LodPoolInstanceSeats.Reset();
+	LodPendingTreeHISMs.Reset();
+	LodPendingTreePools.Reset();
+	LodFailedLayoutVersion = MAX_uint32;
+	LodNumMembers = 0;
+
+	for (UHierarchicalInstancedStaticMeshComponent* Pool : LodPoolHISMs)
+	{
+		if (Pool)
+		{
+			Pool->ClearInstances();
+		}
+	}
+	StandsStats::UpdateCrowdLodCounters(ReportedLodCounters, 0, 0, 0);
+}
+
+void AAGlobalCrowdManager::RestoreCrowdLod()
+{
+	if (LodSeats.IsValid())
+	{
+		for (FCrowdLodSection& Section : LodSections)
+		{
+			Section.Tier = ECrowdLodTier::Full;
+			Section.bSettled = false;
+			Section.MoveCursor = 0;
+		}
+		ApplyCrowdLodMoves(0.0);
+	}
+	ResetCrowdLod();
+}
+
+void AAGlobalCrowdManager::UpdateCrowdLod()
+{
+	STANDS_SCOPE(STAT_Stands_CrowdLod);
+
+	const APlayerController* PC = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+	const APlayerCameraManager* Camera = PC ? PC->PlayerCameraManager : nullptr;
+	if (!LodSeats.IsValid() || !Camera) return;
+
+	FCrowdLodView View;
+	View.Location = Camera->GetCameraLocation();
+	View.Forward = Camera->GetCameraRotation().Vector();
+	View.HalfFov = FMath::DegreesToRadians(FMath::Clamp(Camera->GetFOVAngle(), 1.0f, 179.0f) * 0.5f);
+
+	FCrowdLodSettings Settings;
+	Settings.FullDistance = LodFullDistance;
+	Settings.FarDistance = FMath::Max(LodFarDistance, LodFullDistance);
+	Settings.MaxFullInstances = LodMaxFullInstances;
+	Settings.MaxFrozenInstances = LodMaxFrozenInstances;
+
+	CrowdLod::AssignTiers(LodSections, View, Settings);
+}
+
+void AAGlobalCrowdManager::ApplyCrowdLodMoves(double BudgetSeconds)
+{
+	STANDS_SCOPE(STAT_Stands_CrowdLod);
+
+	if (!LodSeats.IsValid()) return;
+
+	// most significant first, the budget runs out on the ones nobody looks at
+	TArray<int32, TInlineAllocator<64>> Order;
+	for (int32 SectionIdx = 0; SectionIdx < LodSections.Num(); ++SectionIdx)
+	{
+		if (!LodSections[SectionIdx].bSettled)
+		{
+			Order.Add(SectionIdx);
+		}
+	}
+	if (Order.Num() == 0) return;
+
+	Order.Sort([this](int32 A, int32 B)
+	{
+		return LodSections[A].Significance != LodSections[B].Significance ? LodSections[A].Significance > LodSections[B].Significance : A < B;
+	});
+
+	const double StartTime = FPlatformTime::Seconds();
+	TBitArray<> TouchedHISMs(false, CrowdHISMs.Num());
+	TBitArray<> TouchedPools(false, LodPoolHISMs.Num());
+	TArray<int32> Batch;
+	bool bOutOfTime = false;
+	for (const int32 SectionIdx : Order)
+	{
+		FCrowdLodSection& Section = LodSections[SectionIdx];
+		while (Section.MoveCursor < Section.NumSeats && !bOutOfTime)
+		{
+			const int32 End = FMath::Min(Section.MoveCursor + LodMoveBatchSize, Section.NumSeats);
+			Batch.Reset();
+			for (int32 i = Section.MoveCursor; i < End; ++i)
+			{
+				Batch.Add(Section.FirstSeat + i);
+			}
+			MoveSeatsToTier(Batch, Section.Tier, TouchedHISMs, TouchedPools);
+			Section.MoveCursor = End;
+
+			// at least one batch a frame
+			bOutOfTime = BudgetSeconds > 0.0 && FPlatformTime::Seconds() - StartTime >= BudgetSeconds;
+		}
+		Section.bSettled = Section.MoveCursor >= Section.NumSeats;
+		if (bOutOfTime) break;
+	}
+
+	// one instance update per moved component, not a proxy rebuild per batch
+	for (TConstSetBitIterator<> It(TouchedHISMs); It; ++It)
+	{
+		CrowdHISMs[It.GetIndex()]->MarkRenderInstancesDirty();
+	}
+	for (TConstSetBitIterator<> It(TouchedPools); It; ++It)
+	{
+		LodPoolHISMs[It.GetIndex()]->MarkRenderInstancesDirty();
+	}
+
+	// unbuilt instances draw fine meanwhile. trees only once the moves are done, not every frame of a transition
+	if (LodPendingTreeHISMs.Num() != TouchedHISMs.Num()) LodPendingTreeHISMs.Init(false, TouchedHISMs.Num());
+	if (LodPendingTreePools.Num() != TouchedPools.Num()) LodPendingTreePools.Init(false, TouchedPools.Num());
+	LodPendingTreeHISMs.CombineWithBitwiseOR(TouchedHISMs, EBitwiseOperatorFlags::MinSize);
+	LodPendingTreePools.CombineWithBitwiseOR(TouchedPools, EBitwiseOperatorFlags::MinSize);
+
+	bool bAllSettled = true;
+	for (const FCrowdLodSection& Section : LodSections)
+	{
+		bAllSettled &= Section.bSettled;
+	}
+	if (bAllSettled)
+	{
+		for (TConstSetBitIterator<> It(LodPendingTreeHISMs); It; ++It)
+		{
+			CrowdHISMs[It.GetIndex()]->BuildTreeIfOutdated(true, false);
+		}
+		for (TConstSetBitIterator<> It(LodPendingTreePools); It; ++It)
+		{
+			LodPoolHISMs[It.GetIndex()]->BuildTreeIfOutdated(true, false);
+		}
+		LodPendingTreeHISMs.Init(false, LodPendingTreeHISMs.Num());
+		LodPendingTreePools.Init(false, LodPendingTreePools.Num());
+	}
+
+	int32 NumFull = 0;
+	for (const TArray<int32>& InstanceSeats : HismInstanceSeats)
+	{
+		NumFull += InstanceSeats.Num();
+	}
+	int32 NumFrozen = 0;
+	int32 NumFar = 0;
+	for (int32 PoolIdx = 0; PoolIdx < LodPoolInstanceSeats.Num(); ++PoolIdx)
+	{
+		(PoolIdx < CrowdCharacterVariants.Num() ? NumFrozen : NumFar) += LodPoolInstanceSeats[PoolIdx].Num();
+	}
+	StandsStats::UpdateCrowdLodCounters(ReportedLodCounters, NumFull, NumFrozen, NumFar);
+}
+
+int32 AAGlobalCrowdManager::GetLodPool(int32 SeatIdx, ECrowdLodTier Tier) const
+{
+	const int32 HismIdx = LodSeatHism[SeatIdx];
+	if (HismIdx == INDEX_NONE || Tier == ECrowdLodTier::Full) return INDEX_NONE;
+
+	const int32 VariantIdx = bSingleHISMPerMesh ? HismIdx : HismIdx / FMath::Max(LodNumMatsPerVariant, 1);
+	if (Tier == ECrowdLodTier::Frozen) return VariantIdx;
+
+	// thinned by seat, the same members stay every time
+	const uint32 SeatId = FStandsRandom::SeatId(LodSeats->GetLocation(SeatIdx));
+	const bool bKeep = FStandsRandom::Fraction(CrowdRandomSeed, SeatId, EStandsRandomStream::LodThinning) < LodFarKeepFraction;
+	return bKeep ? CrowdCharacterVariants.Num() + VariantIdx : INDEX_NONE;
+}
+
+bool AAGlobalCrowdManager::IsSeatInTier(int32 SeatIdx, ECrowdLodTier Tier) const
+{
+	// empty seats are in every tier
+	if (LodSeatHism[SeatIdx] == INDEX_NONE) return true;
+	if (Tier == ECrowdLodTier::Full) return SeatInstanceSlots[SeatIdx].X != INDEX_NONE;
+
+	// culled = nowhere
+	const int32 Pool = GetLodPool(SeatIdx, Tier);
+	if (Pool == INDEX_NONE) return SeatInstanceSlots[SeatIdx].X == INDEX_NONE && LodSeatSlots[SeatIdx].X == INDEX_NONE;
+	return LodSeatSlots[SeatIdx].X == Pool;
+}
+
+void AAGlobalCrowdManager::MoveSeatsToTier(const TArray<int32>& Seats, ECrowdLodTier Tier, TBitArray<>& TouchedHISMs, TBitArray<>& TouchedPools)
+{
+	TArray<int32> Moving;
+	TArray<int32> FromHISMs;
+	TArray<int32> FromPools;
+	for (const int32 SeatIdx : Seats)
+	{
+		if (IsSeatInTier(SeatIdx, Tier)) continue;
+
+		Moving.Add(SeatIdx);
+		if (SeatInstanceSlots[SeatIdx].X != INDEX_NONE)
+		{
+			FromHISMs.Add(SeatIdx);
+		}
+		else if (LodSeatSlots[SeatIdx].X != INDEX_NONE)
+		{
+			FromPools.Add(SeatIdx);
+		}
+	}
+	if (Moving.Num() == 0) return;
+
+	// 1. out, one RemoveInstances per component. Full's custom data first, clip changes made since
+	// InitCrowdLod live only in the HISM and the removal overwrites the slot
+	for (const int32 SeatIdx : FromHISMs)
+	{
+		const FIntPoint Slot = SeatInstanceSlots[SeatIdx];
+		const UHierarchicalInstancedStaticMeshComponent* HISM = CrowdHISMs[Slot.X];
+		if (HISM->NumCustomDataFloats != LodNumCustomData || HISM->PerInstanceSMCustomData.Num() < (Slot.Y + 1) * LodNumCustomData) continue;
+
+		FMemory::Memcpy(&LodSeatCustomData[SeatIdx * LodNumCustomData], &HISM->PerInstanceSMCustomData[Slot.Y * LodNumCustomData], LodNumCustomData * sizeof(float));
+	}
+	RemoveSeatInstances(FromHISMs, CrowdHISMs, SeatInstanceSlots, HismInstanceSeats, TouchedHISMs);
+	RemoveSeatInstances(FromPools, LodPoolHISMs, LodSeatSlots, LodPoolInstanceSeats, TouchedPools);
+
+	// 2. in, grouped by target. Full gets its custom data back, pools the time offset
+	const bool bToFull = Tier == ECrowdLodTier::Full;
+	const int32 NumTargets = bToFull ? CrowdHISMs.Num() : LodPoolHISMs.Num();
+	TArray<TArray<int32>> AddSeats;
+	TArray<TArray<FTransform>> AddTransforms;
+	TArray<TArray<float>> AddCustomData;
+	AddSeats.SetNum(NumTargets);
+	AddTransforms.SetNum(NumTargets);
+	AddCustomData.SetNum(NumTargets);
+
+	const FSeatLayout& Layout = *LodSeats;
+	for (const int32 SeatIdx : Moving)
+	{
+		const int32 Target = bToFull ? LodSeatHism[SeatIdx] : GetLodPool(SeatIdx, Tier);
+		if (Target == INDEX_NONE) continue; // culled
+
+		AddSeats[Target].Add(SeatIdx);
+		AddTransforms[Target].Add(OffsetTransform * Layout.GetTransform(SeatIdx));
+		const float* CustomData = &LodSeatCustomData[SeatIdx * LodNumCustomData];
+		AddCustomData[Target].Append(CustomData, bToFull ? LodNumCustomData : CrowdCustomData::NumPerClipHISM);
+	}
+
+	for (int32 Target = 0; Target < NumTargets; ++Target)
+	{
+		if (AddSeats[Target].Num() == 0) continue;
+
+		if (bToFull)
+		{
+			AddSeatInstances(AddSeats[Target], CrowdHISMs[Target], Target, AddTransforms[Target], AddCustomData[Target], SeatInstanceSlots, HismInstanceSeats[Target]);
+			TouchedHISMs[Target] = true;
+		}
+		else
+		{
+			AddSeatInstances(AddSeats[Target], LodPoolHISMs[Target], Target, AddTransforms[Target], AddCustomData[Target], LodSeatSlots, LodPoolInstanceSeats[Target]);
+			TouchedPools[Target] = true;
+		}
+	}
+}
+
+void AAGlobalCrowdManager::TriggerCrowdWave(FVector Origin, ECrowdWaveShape Shape, float Speed, float Width, float Seconds)
+{
+	const double Now = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+	SignalState.WaveShape = Shape;
+	SignalState.WaveSpeed = Speed;
+	SignalState.WaveWidth = Width;
+	SignalState.WaveStartTime = Now;
+	SignalState.WaveSeconds = FMath::Max(Seconds, 0.0f);
+	SignalState.WaveOrigin = Origin;
+	SignalState.WaveStartAngle = 0.0f;
+
+	// around the bowl center, starting at the origin's angle
+	if (Shape == ECrowdWaveShape::AroundBowl)
+	{
+		const FVector Center = GetBowlCenter();
+		SignalState.WaveOrigin = Center;
+		SignalState.WaveStartAngle = FMath::RadiansToDegrees(FMath::Atan2(Origin.Y - Center.Y, Origin.X - Center.X));
+	}
+
+	WriteCrowdSignals();
+}
+
+FVector AAGlobalCrowdManager::GetBowlCenter()
+{
+	// every seat, occupied or not and in whatever LOD tier. the HISM bounds move with who sits where
+	TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> Seats = LodSeats;
+	if (!Seats.IsValid() && SeatManager)
+	{
+		Seats = SeatManager->GetSeatLayout();
+	}
+	if (!Seats.IsValid() || Seats->Num() == 0) return GetActorLocation();
+	if (Seats->Version == BowlCenterLayoutVersion) return BowlCenter;
+
+	FBox SeatBox(ForceInit);
+	for (int32 SeatIdx = 0; SeatIdx < Seats->Num(); ++SeatIdx)
+	{
+		SeatBox += Seats->GetLocation(SeatIdx);
+	}
+	BowlCenterLayoutVersion = Seats->Version;
+	BowlCenter = SeatBox.GetCenter();
+	return BowlCenter;
+}
+
+void AAGlobalCrowdManager::StopCrowdWave()
+{
+	SignalState.WaveSeconds = 0.0;
+	WriteCrowdSignals();
+}
+
+void AAGlobalCrowdManager::SetCrowdExcitement(float Level, float BlendSeconds)
+{
+	SignalState.SetExcitement(Level, GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0, BlendSeconds);
+	WriteCrowdSignals();
+}
+
+float AAGlobalCrowdManager::GetCrowdExcitement() const
+{
+	return SignalState.GetExcitement(GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0);
+}
+
+void AAGlobalCrowdManager::SetCrowdGazeTarget(FVector Target, float BlendSeconds)
+{
+	SignalState.SetGaze(Target, 1.0f, GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0, BlendSeconds);
+	WriteCrowdSignals();
+}
+
+void AAGlobalCrowdManager::ClearCrowdGazeTarget(float BlendSeconds)
+{
+	const double Now = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+	SignalState.SetGaze(SignalState.GetGazeTarget(Now), 0.0f, Now, BlendSeconds);
+	WriteCrowdSignals();
+}
+
+void AAGlobalCrowdManager::WriteCrowdSignals()
+{
+	UWorld* World = GetWorld();
+	if (!World || !CrowdSignalCollection) return;
+
+	const double Now = World->GetTimeSeconds();
+	SignalState.Write(World->GetParameterCollectionInstance(CrowdSignalCollection), Now);
+
+	// one more write after the last change, so waves end at 0 fade and blends on their target
+	const bool bWasActive = bCrowdSignalsActive;
+	bCrowdSignalsActive = SignalState.IsActive(Now);
+	if (bWasActive != bCrowdSignalsActive)
+	{
+		UpdateTickEnabled();
+	}
+}
+
+void AAGlobalCrowdManager::UpdateTickEnabled()
+{
+	const UWorld* World = GetWorld();
+	SetActorTickEnabled(World && World->IsGameWorld() && (bEnableCrowdLod || bCrowdSignalsActive));
+}
+
+#if !UE_BUILD_SHIPPING
+
+// Stands.CrowdSignal wave [ripple] | excite <0..1> | gaze | clear
+// every crowd manager in the world. gaze looks at the player camera
+static void RunCrowdSignalCommand(const TArray<FString>& Args, UWorld* World)
+{
+	const FString Signal = Args.Num() > 0 ? Args[0].ToLower() : FString();
+	const APlayerController* PC = World ? World->GetFirstPlayerController() : nullptr;
+	const FVector CameraLocation = PC && PC->PlayerCameraManager ? PC->PlayerCameraManager->GetCameraLocation() : FVector::ZeroVector;
+
+	int32 NumManagers = 0;
+	for (TActorIterator<AAGlobalCrowdManager> It(World); It; ++It)
+	{
+		if (Signal == TEXT("wave"))
+		{
+			const bool bRipple = Args.Num() > 1 && Args[1].Equals(TEXT("ripple"), ESearchCase::IgnoreCase);
+			if (bRipple)
+			{
+				It->TriggerCrowdWave(CameraLocation, ECrowdWaveShape::Ripple, 1500.0f, 800.0f, 10.0f);
+			}
+			else
+			{
+				It->TriggerCrowdWave(CameraLocation);
+			}
+		}
+		else if (Signal == TEXT("excite"))
+		{
+			It->SetCrowdExcitement(Args.Num() > 1 ? FCString::Atof(*Args[1]) : 1.0f);
+		}
+		else if (Signal == TEXT("gaze"))
+		{
+			It->SetCrowdGazeTarget(CameraLocation);
+		}
+		else if (Signal == TEXT("clear"))
+		{
+			It->StopCrowdWave();
+			It->SetCrowdExcitement(0.0f);
+			It->ClearCrowdGazeTarget();
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Stands.CrowdSignal wave [ripple] | excite <0..1> | gaze | clear"));
+			return;
+		}
+		++NumManagers;
+	}
+	UE_LOG(LogTemp, Log, TEXT("Stands.CrowdSignal %s on %d crowd managers"), *Signal, NumManagers);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CrowdSignalCmd(
+	TEXT("Stands.CrowdSignal"),
+	TEXT("Trigger a crowd signal on every crowd manager: wave [ripple] | excite <0..1> | gaze | clear. Waves start at the player camera"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunCrowdSignalCommand));
+
+#if WITH_DEV_AUTOMATION_TESTS
+// square grid, 50 apart, one spawner at the origin
+static TSharedRef<FSeatLayout, ESPMode::ThreadSafe> MakeAllocTestSeats(int32 NumSeats)
+{
+	const TSharedRef<FSeatLayout, ESPMode::ThreadSafe> Layout = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
+	const int32 Side = FMath::CeilToInt32(FMath::Sqrt(static_cast<float>(NumSeats)));
+
+	FSeatChunkLayout Chunk;
+	Chunk.SetNumUninitialized(NumSeats);
+	for (int32 i = 0; i < NumSeats; ++i)
+	{
+		Chunk.Positions[i] = FVector3f((i % Side) * 50.0f, (i / Side) * 50.0f, 0.0f);
+		Chunk.Yaws[i] = 0;
+		Chunk.Rows[i] = FSeatLayout::ClampRowColumn(i / Side);
+		Chunk.Columns[i] = FSeatLayout::ClampRowColumn(i % Side);
+	}
+	Layout->AppendChunk(Chunk, FTransform::Identity);
+	Layout->Version = FSeatLayout::NextVersion();
+	return Layout;
+}
+
+// one volume over every seat, even material weights
+static void MakeAllocTestContext(FCrowdBakeContext& OutContext, const TSharedRef<FSeatLayout, ESPMode::ThreadSafe>& Layout, int32 NumMeshes, int32 NumMats)
+{
+	OutContext.Seats = Layout;
+	OutContext.NumMeshes = NumMeshes;
+	OutContext.NumMats = NumMats;
+	OutContext.NumHISMs = NumMeshes * NumMats;
+	OutContext.RandomSeed = 4242;
+
+	FBox Box(ForceInit);
+	for (int32 i = 0; i < Layout->Num(); ++i)
+	{
+		Box += Layout->GetLocation(i);
+	}
+	OutContext.Volumes.Add(nullptr);
+	OutContext.VolumeBoxes.Add(Box.ExpandBy(100.0));
+	OutContext.VolumeSeeds.Add(7);
+	OutContext.VolumeDensities.Add(0.8f);
+	OutContext.VolumeGrid.Build(OutContext.VolumeBoxes);
+
+	TArray<float> Weights;
+	Weights.Init(1.0f, NumMats);
+	OutContext.WeightTables.AddDefaulted_GetRef().Build(Weights);
+	OutContext.VolumeWeightTable.Add(0);
+}
+
+// reallocations of a TArray growing one element at a time to Num, what the default slack policy does
+static uint64 CountGrowthSteps(int32 Num)
+{
+	TArray<FInstancedStaticMeshInstanceData> Grown;
+	FStandsAllocCountScope Count;
+	for (int32 i = 0; i < Num; ++i)
+	{
+		Grown.AddUninitialized();
+	}
+	return Count.GetCount();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrowdBakeAllocTest, "Stands.Crowd.BakeAllocs",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+// game thread heap allocations of a crowd bake on synthetic seats, at 10k and 100k seats, in a scratch world.
+// plan: per HISM arrays sized once each, a fixed bound whatever the seat count.
+// apply: AddInstances grows each HISM's per instance arrays geometrically, so the bound allows every one of them
+// the reallocations of a TArray growing to that HISM's instance count. logarithmic in the seats, far under
+// one allocation per instance, so anything per seat or per instance fails it at either size
+bool FCrowdBakeAllocTest::RunTest(const FString& Parameters)
+{
+	if (!FStandsAllocCountScope::IsLive())
+	{
+		AddError(TEXT("the allocation counter does not see allocations in this process"));
+		return false;
+	}
+
+	const int32 NumMeshes = 3;
+	const int32 NumMats = 6;
+	const int32 NumHISMs = NumMeshes * NumMats;
+
+	// outer arrays (3), then per HISM: 3 exact fills, the sort order and 3 permutes. slack for ParallelFor
+	const uint64 PlanBound = 3 + 7 * NumHISMs + 16;
+	// per instance arrays a HISM grows while adding (instances, custom data, reorder table, unbuilt bounds,
+	// instance ids, render side copies), with room to spare, and a few fixed allocations per HISM
+	const uint64 GrowingArraysPerHism = 8;
+	const uint64 FixedPerHism = 16;
+
+	FStandsScratchWorld ScratchWorld;
+	UWorld* World = ScratchWorld.Get();
+
+	// never constructed, no BeginPlay and no bake of its own
+	AAGlobalCrowdManager* Manager = World->SpawnActorDeferred<AAGlobalCrowdManager>(AAGlobalCrowdManager::StaticClass(), FTransform::Identity);
+	if (!TestNotNull(TEXT("crowd manager spawned"), Manager)) return false;
+
+	for (int32 HismIdx = 0; HismIdx < NumHISMs; ++HismIdx)
+	{
+		UHierarchicalInstancedStaticMeshComponent* HISM = NewObject<UHierarchicalInstancedStaticMeshComponent>(Manager, NAME_None, RF_Transient);
+		HISM->bAutoRebuildTreeOnInstanceChanges = false;
+		HISM->SetNumCustomDataFloats(CrowdCustomData::NumPerClipHISM);
+		Manager->CrowdHISMs.Add(HISM);
+	}
+
+	for (const int32 NumSeats : { 10000, 100000 })
+	{
+		const TSharedRef<FSeatLayout, ESPMode::ThreadSafe> Layout = MakeAllocTestSeats(NumSeats);
+
+		// first bake warms the mem stack pages and the task pool, the second one is counted
+		FCrowdBakePlan Plan;
+		uint64 PlanCount = 0;
+		for (int32 Bake = 0; Bake < 2; ++Bake)
+		{
+			Plan.HismTransforms.Reset();
+			Plan.HismCustomData.Reset();
+			Plan.HismSeats.Reset();
+			MakeAllocTestContext(Plan.Context, Layout, NumMeshes, NumMats);
+
+			FStandsAllocCountScope Count;
+			AAGlobalCrowdManager::BuildBakePlan(Plan);
+			PlanCount = Count.GetCount();
+		}
+
+		// same for the game thread half, into emptied HISMs
+		uint64 ApplyCount = 0;
+		for (int32 Bake = 0; Bake < 2; ++Bake)
+		{
+			for (UHierarchicalInstancedStaticMeshComponent* HISM : Manager->CrowdHISMs)
+			{
+				HISM->ClearInstances();
+			}
+			Manager->ResetDeltaBookkeeping(Plan.Context);
+			Plan.ApplyHism = 0;
+			Plan.ApplyInstance = 0;
+			Plan.NumApplied = 0;
+
+			FStandsAllocCountScope Count;
+			Manager->ApplyBakePlan(Plan, DBL_MAX, MAX_int32);
+			ApplyCount = Count.GetCount();
+		}
+
+		uint64 ApplyBound = 16;
+		for (const TArray<FTransform>& Transforms : Plan.HismTransforms)
+		{
+			ApplyBound += FixedPerHism + GrowingArraysPerHism * CountGrowthSteps(Transforms.Num());
+		}
+
+		TestEqual(FString::Printf(TEXT("%d seats: every instance applied"), NumSeats), Plan.NumApplied, Plan.NumInstances);
+		TestTrue(FString::Printf(TEXT("%d seats: plan %llu allocations, bound %llu"), NumSeats, PlanCount, PlanBound), PlanCount <= PlanBound);
+		TestTrue(FString::Printf(TEXT("%d seats, %d instances: apply %llu allocations, bound %llu"), NumSeats, Plan.NumInstances, ApplyCount, ApplyBound),
+			ApplyCount <= ApplyBound);
+	}
+
+	Manager->Destroy();
+	return true;
+}
+#endif
+
+#endif
+
+void AAGlobalCrowdManager::BeginDestroy()
+{
+	// ticker holds this manager
+	CancelCrowdBake();
+	StandsStats::UpdateCrowdCounters(ReportedCounters, 0, 0, 0);
+	StandsStats::UpdateCrowdLodCounters(ReportedLodCounters, 0, 0, 0);
+	Super::BeginDestroy();
+}
+
+// Called when the game starts or when spawned
+void AAGlobalCrowdManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// cooked levels load the frozen crowd, no bake
+	if (GetWorld() && GetWorld()->IsGameWorld())
+	{
+		ApplyBakedData();
+
+		// tiers follow the player camera, editor worlds keep the full crowd
+		UpdateTickEnabled();
+
+		const TArray<FName> Missing = CrowdSignals::GetMissingParameters(CrowdSignalCollection);
+		if (Missing.Num() > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: %s has no %s, those crowd signals do nothing"),
+				*GetName(), *CrowdSignalCollection->GetName(), *FString::JoinBy(Missing, TEXT(", "), [](const FName& Name) { return Name.ToString(); }));
+		}
+
+		// defaults in, in case the collection was saved mid wave
+		WriteCrowdSignals();
+	}
+}
+
+// Called every frame
+void AAGlobalCrowdManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bCrowdSignalsActive)
+	{
+		WriteCrowdSignals();
+	}
+
+	if (!bEnableCrowdLod) return;
+
+	// tiers a few times a second, picked up again after every bake
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= LodNextUpdateTime)
+	{
+		LodNextUpdateTime = Now + LodUpdateInterval;
+		if (LodSeats.IsValid() || InitCrowdLod())
+		{
+			UpdateCrowdLod();
+		}
+	}
 
+	// moves every frame, within the budget
+	ApplyCrowdLodMoves(LodBudgetMs / 1000.0);
 }
 
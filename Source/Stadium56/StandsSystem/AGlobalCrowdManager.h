@@ -6,55 +6,42 @@
 #include "GameFramework/Actor.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Components/SceneComponent.h"
+#include "Engine/LatentActionManager.h"
+#include "Containers/Ticker.h"
 #include "StandsSystem/ACrowdVolume.h"
+#include "StandsSystem/CrowdBake.h"
+#include "StandsSystem/CrowdLod.h"
+#include "StandsSystem/CrowdSignals.h"
+#include "StandsSystem/CrowdWeights.h"
+#include "StandsSystem/SeatLayout.h"
+#include "StandsSystem/StandsStats.h"
 #include "AGlobalCrowdManager.generated.h"
 
 class AAGlobalSeatManager;
+class UMaterialParameterCollection;
+struct FCrowdSeatPicks;
 
-USTRUCT(BlueprintType)
-struct FMaterialWeights
+// exec pins of BakeCrowdLatent
+UENUM(BlueprintType)
+enum class ECrowdBakeLatentResult : uint8
 {
-	GENERATED_BODY()
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
-	float WaveHand;
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
-	float ClapHigh;
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
-	float Clap;
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
-	float Upset;
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
-	float Idle;
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
-	float Yell;
-
-	FMaterialWeights()
-	{
-		WaveHand = 100.f;
-		ClapHigh = 100.f;
-		Clap = 100.f;
-		Upset = 100.f;
-		Idle = 100.f;
-		Yell = 100.f;
-	}
+	// fires every frame while baking, read Progress
+	Progress,
+	Completed,
+	// superseded by a newer bake, or the manager went away
+	Cancelled,
+};
 
-	float GetWeightByIndex(int32 Index) const
-	{
-		switch (Index)
-		{
-			case 0: return WaveHand;
-			case 1: return ClapHigh;
-			case 2: return Clap;
-			case 3: return Upset;
-			case 4: return Idle;
-			case 5: return Yell;
-			default: return 0.0f;
-		}
-	}
+// per instance custom data of the crowd HISMs
+namespace CrowdCustomData
+{
+	constexpr int32 TimeOffset = 0;
+	// single HISM per mesh only, VATMats index as float
+	constexpr int32 ClipIndex = 1;
 
-	int32 GetNumWeights() const { return 6; }
-};
+	constexpr int32 NumPerClipHISM = 1;
+	constexpr int32 NumSingleHISM = 2;
+}
 
 // 3sm * 6MI vat
 USTRUCT(BlueprintType)
@@ -68,9 +55,24 @@ struct FCharacterVariant
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Asset")
 	TArray<UMaterialInterface*> VATMats;
 
+	// single HISM mode: one VAT material with every clip (texture array), picks the clip from custom data
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Asset")
+	UMaterialInterface* ClipArrayMat;
+
+	// LOD Frozen and Far tiers: a posed static mesh, Mesh if none
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Asset|LOD")
+	UStaticMesh* FrozenMesh;
+
+	// LOD Frozen and Far tiers: every slot, no VAT. the mesh's own materials if none
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Asset|LOD")
+	UMaterialInterface* FrozenMat;
+
 	FCharacterVariant() //default
 	{
 		Mesh = nullptr;
+		ClipArrayMat = nullptr;
+		FrozenMesh = nullptr;
+		FrozenMat = nullptr;
 	}
 };
 
@@ -83,10 +85,84 @@ public:
 	// Sets default values for this actor's properties
 	AAGlobalCrowdManager(); 
 	virtual void OnConstruction(const FTransform& Transform) override;
+	virtual void BeginDestroy() override;
 
 	UFUNCTION(BlueprintCallable, Category = "Parm", meta = (CallInEditor = "true"))
 	void BakeCrowd();
 
+	// BakeCrowd, then freeze seats and crowd into the seat manager's BakedData.
+	// game worlds load that instead of generating, filtering and picking
+	UFUNCTION(BlueprintCallable, Category = "Parm", meta = (CallInEditor = "true"))
+	void BakeAndFreeze();
+
+	// BakeCrowd without the hitch: filter and picks on a worker, HISM adds spread over frames (AsyncBakeBudgetMs).
+	// a newer bake, async or not, cancels this one
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void BakeCrowdAsync();
+
+	// BakeCrowdAsync as a latent node. Progress goes 0..1, filter first half, HISM adds second
+	UFUNCTION(BlueprintCallable, Category = "Parm", meta = (Latent, LatentInfo = "LatentInfo", ExpandEnumAsExecs = "Result"))
+	void BakeCrowdLatent(FLatentActionInfo LatentInfo, ECrowdBakeLatentResult& Result, float& Progress);
+
+	// instances over all crowd HISMs
+	int32 GetNumCrowdInstances() const;
+
+	AAGlobalSeatManager* GetSeatManager() const { return SeatManager; }
+
+	// BakedData was baked from the level's seats and these crowd settings
+	bool HasCurrentBakedData() const;
+
+	// 1 when no async bake is running
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	float GetCrowdBakeProgress() const;
+
+	// stop the running async bake. instances added so far stay
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void CancelCrowdBake();
+
+	// delta bake after a volume moved or changed. only seats in its old and new box are re-evaluated
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void RebakeVolume(AACrowdVolume* Volume);
+
+	// single HISM mode: switch the animation of the member on this seat (SeatLayout index).
+	// one custom data write, the instance stays where it is
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	bool SetCrowdMemberClip(int32 SeatIndex, int32 ClipIndex);
+
+	// LOD tiers in game worlds. off puts every member back in the crowd HISMs right away
+	UFUNCTION(BlueprintCallable, Category = "Parm|LOD")
+	void SetCrowdLodEnabled(bool bEnabled);
+
+	// tier the member on this seat (SeatLayout index) is drawn in now, Full without LOD
+	UFUNCTION(BlueprintCallable, Category = "Parm|LOD")
+	ECrowdLodTier GetSeatLodTier(int32 SeatIndex) const;
+
+	// crowd signals: values in CrowdSignalCollection the VAT materials react to, see CrowdSignals.h.
+	// a handful of parameter writes per frame while something changes, none per instance
+
+	// wave from Origin. Speed cm/s and Width cm for Ripple, degrees/s and degrees for AroundBowl.
+	// a new wave replaces the running one
+	UFUNCTION(BlueprintCallable, Category = "Parm|Signals")
+	void TriggerCrowdWave(FVector Origin, ECrowdWaveShape Shape = ECrowdWaveShape::AroundBowl, float Speed = 30.0f, float Width = 20.0f, float Seconds = 15.0f);
+
+	UFUNCTION(BlueprintCallable, Category = "Parm|Signals")
+	void StopCrowdWave();
+
+	// 0 calm .. 1 goal, eased over BlendSeconds
+	UFUNCTION(BlueprintCallable, Category = "Parm|Signals")
+	void SetCrowdExcitement(float Level, float BlendSeconds = 0.5f);
+
+	UFUNCTION(BlueprintCallable, Category = "Parm|Signals")
+	float GetCrowdExcitement() const;
+
+	// everyone turns towards Target (ball, player, scoreboard)
+	UFUNCTION(BlueprintCallable, Category = "Parm|Signals")
+	void SetCrowdGazeTarget(FVector Target, float BlendSeconds = 0.5f);
+
+	// back to the clip's own facing
+	UFUNCTION(BlueprintCallable, Category = "Parm|Signals")
+	void ClearCrowdGazeTarget(float BlendSeconds = 0.5f);
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -116,10 +192,58 @@ protected:
 	UPROPERTY()
 	TArray<UHierarchicalInstancedStaticMeshComponent*> CrowdHISMs;
 
+	// one HISM per mesh with ClipArrayMat instead of one per mesh * VAT material.
+	// VATMats still lists the clips, the index goes to custom data
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Assets")
+	bool bSingleHISMPerMesh;
+
 	// possibility weights
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Assets")
 	FMaterialWeights MaterialWeights;
 
+	// seed for mesh, material and time offset picks. same seed + same seats = same crowd
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Assets")
+	int32 CrowdRandomSeed;
+
+	// game thread time per frame an async bake may spend adding instances
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Bake", meta = (ClampMin = "0.1"))
+	float AsyncBakeBudgetMs;
+
+	// game worlds: each seat spawner's section is Full, Frozen or Far by distance to the player camera,
+	// then by significance within the instance budgets. members move between the crowd HISMs and pooled frozen HISMs
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD")
+	bool bEnableCrowdLod;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0.0"))
+	float LodFullDistance;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0.0"))
+	float LodFarDistance;
+
+	// most VAT instances at once, the least significant sections freeze first
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0"))
+	int32 LodMaxFullInstances;
+
+	// most frozen instances at once, the least significant sections go Far first
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0"))
+	int32 LodMaxFrozenInstances;
+
+	// members of Far sections still drawn, 0 culls them all. same seats every time
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float LodFarKeepFraction;
+
+	// seconds between tier updates from the camera
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0.0"))
+	float LodUpdateInterval;
+
+	// game thread time per frame for moving members between tiers
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|LOD", meta = (ClampMin = "0.1"))
+	float LodBudgetMs;
+
+	// CrowdWaveOrigin, CrowdWaveParams, CrowdWaveStartAngle, CrowdExcitement, CrowdGazeTarget. the VAT materials read the same collection
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Signals")
+	UMaterialParameterCollection* CrowdSignalCollection;
+
 private:
 	// bake when spawned first timne
 	UPROPERTY()
@@ -128,15 +252,152 @@ private:
 	// clean HISMs
 	void ClearCrowd();
 
-	// expensive. get all seat transforms, and filter them by crowd volumes
-	TArray<FTransform> GetFilteredSeatTransforms() const;
+	// fill the HISMs from the seat manager's BakedData. false if it has no crowd, doesn't fit the variants or is stale
+	bool ApplyBakedData();
+
+	// volumes, volume grid and weight tables, once per bake
+	void BuildBakeContext(FCrowdBakeContext& OutContext) const;
+
+	// volume that keeps this seat, INDEX_NONE if empty. context only, any thread
+	static int32 FindSeatVolume(const FCrowdBakeContext& Context, const FVector& SeatLocation);
+
+	// HISM and time offset of a kept seat
+	static int32 PickSeatHISM(const FCrowdBakeContext& Context, const FVector& SeatLocation, int32 VolumeIdx, float& OutTimeOffset, int32& OutClipIdx);
+
+	// write the clip slot. false if nothing changed
+	bool SetInstanceClip(int32 HismIdx, int32 InstanceIdx, int32 ClipIdx, bool bMarkRenderStateDirty);
+
+	// clips the variant behind this crowd HISM has, 0 if none
+	int32 GetHismNumClips(int32 HismIdx) const;
+
+	// expensive. first pass of a bake: volume filter and picks for every seat of the snapshot,
+	// plus instances per HISM. OutPicks lives on the calling thread's mem stack. any thread
+	static void PickSeats(FCrowdBakePlan& Plan, FCrowdSeatPicks& OutPicks);
 
 	void SetupHISMComponents();
+	// crowd HISMs the variants make: one per mesh, or one per mesh * clip
+	int32 GetNumHISMsNeeded() const;
+
+	// pick, then fill exactly sized per HISM arrays. volumes may bring their own weight profile. any thread.
+	// heap allocations scale with the HISM count, not the seat count
+	static void BuildBakePlan(FCrowdBakePlan& Plan);
+
+	// add planned instances until the budget runs out. true when all are in
+	bool ApplyBakePlan(FCrowdBakePlan& Plan, double BudgetSeconds, int32 BatchSize);
+
+	// async bake ticker, game thread
+	bool TickAsyncBake(float DeltaTime);
+
+	// running async bake, null if none. shared with its worker
+	TSharedPtr<FCrowdBakePlan, ESPMode::ThreadSafe> AsyncBake;
+	FTSTicker::FDelegateHandle AsyncBakeTickerHandle;
+	// last async bake started / finished, the latent node compares against these
+	uint32 AsyncBakeSerial = 0;
+	uint32 CompletedBakeSerial = 0;
+
+	friend class FCrowdBakeLatentAction;
+	friend class FCrowdBakeAllocTest;
+	friend class FStandsBenchmark;
+	friend class FStandsMemReport;
+
+	// delta bake bookkeeping, rebuilt by every full bake
+	void ResetDeltaBookkeeping(const FCrowdBakeContext& Context);
+	bool IsDeltaBookkeepingValid(const FSeatLayout& Layout) const;
+
+	// loaded level: the HISM instances are saved, the bookkeeping is not. matches every instance back to its seat
+	// by location. true if the bookkeeping is valid afterwards. warns once per seat snapshot if it can't
+	bool RestoreDeltaBookkeeping();
+	uint32 FailedRestoreLayoutVersion = MAX_uint32;
+	static uint32 HashSeatLayout(const FSeatLayout& Seats);
+	// everything on this manager a pick depends on: offset, weights, seed, variants, HISM mode
+	uint32 HashCrowdSettings() const;
+
+	// per seat: X = HISM, Y = instance. INDEX_NONE if empty
+	TArray<FIntPoint> SeatInstanceSlots;
+	// per HISM: instance -> seat
+	TArray<TArray<int32>> HismInstanceSeats;
+	// snapshot the bookkeeping was built from. same version -> no need to hash
+	uint32 BakedSeatLayoutVersion = 0;
+	uint32 BakedSeatLayoutHash = 0;
+	// HashCrowdSettings at the last bake. different -> a delta would mix old and new picks.
+	// saved with the instances, so a loaded crowd can be checked against the settings too
+	UPROPERTY()
+	uint32 BakedSettingsHash = 0;
+	// where each volume was at the last bake
+	TMap<TObjectKey<AACrowdVolume>, FBox> BakedVolumeBoxes;
+
+	// runs of seats with the same spawner (X = first seat, Y = count) and their seat bounds on a grid,
+	// so a volume delta only visits the spawners it touches. per seat snapshot
+	void UpdateSeatRunGrid(const FSeatLayout& Layout);
+	TArray<FIntPoint> SeatRuns;
+	FCrowdVolumeGrid SeatRunGrid;
+	uint32 SeatRunGridVersion = 0;
+
+	// this manager's share of stat Stands
+	StandsStats::FCrowdCounters ReportedCounters;
+	StandsStats::FCrowdLodCounters ReportedLodCounters;
+
+	// LOD pools: Frozen of variant v at v, Far at NumVariants + v. game worlds only
+	UPROPERTY(Transient)
+	TArray<UHierarchicalInstancedStaticMeshComponent*> LodPoolHISMs;
+
+	// seats the LOD state was built from, null = not built. rebuilt after every bake
+	TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> LodSeats;
+	TArray<FCrowdLodSection> LodSections;
+	// per seat: crowd HISM it belongs to (INDEX_NONE = empty) and its custom data, for the way back to Full
+	TArray<int16> LodSeatHism;
+	TArray<float> LodSeatCustomData;
+	int32 LodNumCustomData = 0;
+	int32 LodNumMatsPerVariant = 0;
+	int32 LodNumMembers = 0;
+	// per seat: X = pool, Y = instance. INDEX_NONE if not pooled
+	TArray<FIntPoint> LodSeatSlots;
+	// per pool: instance -> seat
+	TArray<TArray<int32>> LodPoolInstanceSeats;
+	// components moved since their last tree build. built once every section has settled
+	TBitArray<> LodPendingTreeHISMs;
+	TBitArray<> LodPendingTreePools;
+	double LodNextUpdateTime = 0.0;
+	// seat snapshot InitCrowdLod gave up on, warned once
+	uint32 LodFailedLayoutVersion = MAX_uint32;
+
+	// LOD state from the crowd HISMs and their bookkeeping, everything Full. restores the bookkeeping of a
+	// loaded crowd first. false if there is no crowd
+	bool InitCrowdLod();
+	void SetupLodPools();
+
+	// forget the LOD state and empty the pools. the crowd HISMs stay as they are
+	void ResetCrowdLod();
+
+	// every member back in the crowd HISMs, then ResetCrowdLod. before anything that patches the crowd HISMs
+	void RestoreCrowdLod();
+
+	// section tiers from the player camera
+	void UpdateCrowdLod();
+
+	// move members of unsettled sections, most significant first, until the budget runs out. 0 = no budget
+	void ApplyCrowdLodMoves(double BudgetSeconds);
+
+	// pool a member of this seat goes to in Tier, INDEX_NONE for Full or culled
+	int32 GetLodPool(int32 SeatIdx, ECrowdLodTier Tier) const;
+	bool IsSeatInTier(int32 SeatIdx, ECrowdLodTier Tier) const;
+
+	// out of wherever they are, into Tier. marks the components that changed
+	void MoveSeatsToTier(const TArray<int32>& Seats, ECrowdLodTier Tier, TBitArray<>& TouchedHISMs, TBitArray<>& TouchedPools);
+
+	FCrowdSignalState SignalState;
+	// AroundBowl center: middle of the seat layout bounds, kept per snapshot
+	uint32 BowlCenterLayoutVersion = 0;
+	FVector BowlCenter = FVector::ZeroVector;
+	FVector GetBowlCenter();
+	// a wave or blend is running, Tick writes the collection
+	bool bCrowdSignalsActive = false;
 
-	// randomly assign crowd to HISMs
-	void PopulateHISMs(const TArray<FTransform>& FilteredSeats);
+	// write SignalState to the world's collection instance, keep ticking while it changes
+	void WriteCrowdSignals();
 
-	int32 PickMIByWeight() const;
+	// tick for crowd LOD or running signals, game worlds only
+	void UpdateTickEnabled();
 
 public:	
 	// Called every frame
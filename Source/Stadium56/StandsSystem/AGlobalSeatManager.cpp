@@ -3,9 +3,30 @@
 
 #include "StandsSystem/AGlobalSeatManager.h"
 #include "StandsSystem/ASeatSpawnerBase.h"
+#include "StandsSystem/SpatialOrder.h"
+#include "StandsSystem/StandsBakedData.h"
+#include "StandsSystem/StandsStats.h"
 #include "UObject/ConstructorHelpers.h"
+#include "StandsSystem/StandsHISMComponent.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Crc.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Tasks/Task.h"
+
+// one dirty chunk's combine, shipped to a worker and back
+struct FSeatCombineJob
+{
+	TWeakObjectPtr<AActor> Spawner;
+	uint32 Serial = 0;
+	FSeatChunkLayout Seats;
+	FTransform SpawnerTransform;
+	TArray<FTransform> Transforms;
+};
 
 // Sets default values
 AAGlobalSeatManager::AAGlobalSeatManager()
@@ -36,26 +57,121 @@ AAGlobalSeatManager::AAGlobalSeatManager()
 	// initialize rotations
 	SeatRotationOffset = FRotator::ZeroRotator;
 	ConeRotationOffset = FRotator(-90.0f, 0.0f, 0.0f);
+
+	bAsyncSeatRebuild = true;
+	BakedData = nullptr;
 }
 
 // called by ASeatSpawner to register Transforms
 void AAGlobalSeatManager::RegisterSeatChunk(AActor* Spawner, const TArray<FTransform>& RawTransforms)
 {
 	if (!Spawner) return;
+	LLM_SCOPE_BYTAG(Stands);
+
+	// only the location survives, seats face the spawner's forward like before
+	const AASeatSpawnerBase* SeatSpawner = Cast<AASeatSpawnerBase>(Spawner);
+	const float RowSpacing = SeatSpawner ? SeatSpawner->GetRowSpacing() : 1.0f;
+	const float ColumnSpacing = SeatSpawner ? SeatSpawner->GetColumnSpacing() : 1.0f;
+
+	// one conversion straight into the chunk, which then moves into the manager
+	const uint16 SpawnerYaw = SeatSpawner ? FSeatLayout::QuantizeYaw(SeatSpawner->GetLocalForwardDirection().Rotation().Yaw) : 0;
+	FSeatChunkLayout Seats;
+	Seats.SetNumUninitialized(RawTransforms.Num());
+	for (int32 i = 0; i < RawTransforms.Num(); ++i)
+	{
+		const FVector Location = RawTransforms[i].GetLocation();
+
+		Seats.Positions[i] = FVector3f(Location);
+		Seats.Yaws[i] = SeatSpawner ? SpawnerYaw : FSeatLayout::QuantizeYaw(RawTransforms[i].Rotator().Yaw);
+		Seats.Rows[i] = FSeatLayout::ClampRowColumn(FMath::RoundToInt32(Location.X / RowSpacing));
+		Seats.Columns[i] = FSeatLayout::ClampRowColumn(FMath::RoundToInt32(Location.Y / ColumnSpacing));
+	}
 
-	FSeatTransformChunk NewChunk;
-	NewChunk.Transforms = RawTransforms;
-	ChunkData.Add(Spawner, NewChunk);
-	RebuildHISMs();
+	RegisterSeatLayout(Spawner, MoveTemp(Seats));
+}
+
+void AAGlobalSeatManager::RegisterSeatLayout(AActor* Spawner, FSeatChunkLayout&& Seats)
+{
+	// frozen seats don't follow the spawners anymore
+	if (!Spawner || bSeatLayoutFrozen) return;
+	LLM_SCOPE_BYTAG(Stands);
+
+	// keep the chunk's HISM, only its instances change
+	FSeatTransformChunk& Chunk = ChunkData.FindOrAdd(Spawner);
+	Chunk.Seats = MoveTemp(Seats);
+	Chunk.bDirty = true;
+	RequestRebuild();
 }
 
 // remove from manager when destroyed
 void AAGlobalSeatManager::UnregisterSeatChunk(AActor* Spawner)
 {
 	if (!Spawner) return;
-	if (ChunkData.Remove(Spawner) >0 )
+	if (FSeatTransformChunk* Chunk = ChunkData.Find(Spawner))
+	{
+		DestroyChunkHISM(*Chunk);
+		ChunkData.Remove(Spawner);
+		RequestRebuild();
+	}
+}
+
+void AAGlobalSeatManager::BeginSeatUpdate()
+{
+	++SeatUpdateDepth;
+}
+
+void AAGlobalSeatManager::EndSeatUpdate()
+{
+	if (SeatUpdateDepth <= 0)
 	{
-		RebuildHISMs();
+		UE_LOG(LogTemp, Warning, TEXT("EndSeatUpdate without BeginSeatUpdate on %s"), *GetName());
+		return;
+	}
+
+	if (--SeatUpdateDepth == 0)
+	{
+		FlushSeatUpdates();
+	}
+}
+
+void AAGlobalSeatManager::FlushSeatUpdates()
+{
+	if (bRebuildPending)
+	{
+		UpdateChunkHISMs();
+	}
+}
+
+void AAGlobalSeatManager::RequestRebuild()
+{
+	bRebuildPending = true;
+	++NumPendingRequests;
+
+	// level load registers every spawner in one frame -> one rebuild
+	if (SeatUpdateDepth == 0 && !EndFrameFlushHandle.IsValid())
+	{
+		EndFrameFlushHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &AAGlobalSeatManager::OnEndFrameFlush);
+	}
+}
+
+void AAGlobalSeatManager::OnEndFrameFlush()
+{
+	CancelEndFrameFlush();
+
+	// batch still open, EndSeatUpdate will flush
+	if (SeatUpdateDepth == 0 && bRebuildPending)
+	{
+		// nobody waits on the end of frame rebuild, keep the combine off the game thread
+		UpdateChunkHISMs(bAsyncSeatRebuild);
+	}
+}
+
+void AAGlobalSeatManager::CancelEndFrameFlush()
+{
+	if (EndFrameFlushHandle.IsValid())
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameFlushHandle);
+		EndFrameFlushHandle.Reset();
 	}
 }
 
@@ -75,77 +191,389 @@ void AAGlobalSeatManager::UpdateHISMVisuals()
 		TargetMesh = SeatMesh;
 	}
 
-	if (SeatGridHISM)
+	const FVector IndividualScale = bUseDebugMesh ? FVector(0.5f) : FVector(1.0f);
+	const FRotator IndividualRotation = bUseDebugMesh ? ConeRotationOffset : SeatRotationOffset;
+
+	// seat vs cone touches every instance
+	if (TargetMesh != BuiltSeatMesh.Get() || IndividualScale != BuiltScale || !IndividualRotation.Equals(BuiltRotation, 0.0f))
 	{
-		if (TargetMesh != SeatGridHISM->GetStaticMesh())
+		BuiltSeatMesh = TargetMesh;
+		BuiltScale = IndividualScale;
+		BuiltRotation = IndividualRotation;
+
+		for (TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
 		{
-			SeatGridHISM->SetStaticMesh(TargetMesh);
+			Pair.Value.bDirty = true;
 		}
 	}
 }
 
 void AAGlobalSeatManager::RebuildHISMs()
 {
+	for (TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
+	{
+		Pair.Value.bDirty = true;
+	}
+	UpdateChunkHISMs();
+}
+
+void AAGlobalSeatManager::UpdateChunkHISMs(bool bAsyncCombine)
+{
+	STANDS_SCOPE(STAT_Stands_RebuildHISMs);
+
 	if (!SeatGridHISM) return;
 
-	// 1. setup HISM
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumRequests = NumPendingRequests;
+	bRebuildPending = false;
+	NumPendingRequests = 0;
+
+	// 1. setup HISMs
 	UpdateHISMVisuals();
+	UStaticMesh* TargetMesh = BuiltSeatMesh.Get();
 
-	// 2. clean all old instances
-	SeatGridHISM->ClearInstances();
+	// old levels stored every seat here
+	if (SeatGridHISM->GetInstanceCount() > 0)
+	{
+		SeatGridHISM->ClearInstances();
+	}
 	SeatGridHISM->bSelectable = false;
 
-	// 3. validate
-	const bool bHasValidMesh = (SeatGridHISM->GetStaticMesh() != nullptr);
-	if (!bHasValidMesh)
+	// 2. refill only the chunks that changed. transforms exist one chunk at a time
+	int32 NumRefilled = 0;
+	TArray<FTransform> ChunkTransforms;
+	const TSharedRef<TArray<FSeatCombineJob>, ESPMode::ThreadSafe> Jobs = MakeShared<TArray<FSeatCombineJob>, ESPMode::ThreadSafe>();
+	const uint32 Serial = bAsyncCombine ? ++CombineSerial : 0;
+	for (TMap<TWeakObjectPtr<AActor>, FSeatTransformChunk>::TIterator It = ChunkData.CreateIterator(); It; ++It)
 	{
-		SeatGridHISM->SetVisibility(false);
-		return;
+		FSeatTransformChunk& Chunk = It.Value();
+
+		// spawner gone without unregistering (level unload, undo)
+		if (!It.Key().IsValid())
+		{
+			DestroyChunkHISM(Chunk);
+			It.RemoveCurrent();
+			continue;
+		}
+
+		if (!Chunk.bDirty) continue;
+		Chunk.bDirty = false;
+		++NumRefilled;
+
+		// a sync fill overrides whatever is still in flight
+		Chunk.PendingCombineSerial = Serial;
+
+		const AASeatSpawnerBase* Spawner = Cast<AASeatSpawnerBase>(It.Key().Get());
+		if (Spawner)
+		{
+			Chunk.SpawnerTransform = Spawner->GetActorTransform();
+			Chunk.SpawnerTransform.SetScale3D(FVector(1.0f, 1.0f, 1.0f));
+		}
+
+		if (bAsyncCombine && Spawner)
+		{
+			FSeatCombineJob& Job = Jobs->AddDefaulted_GetRef();
+			Job.Spawner = It.Key();
+			Job.Serial = Serial;
+			Job.Seats = Chunk.Seats;
+			Job.SpawnerTransform = Chunk.SpawnerTransform;
+			continue;
+		}
+
+		ChunkTransforms.Reset();
+		if (Spawner)
+		{
+			CombineChunkTransforms(Chunk.Seats, Chunk.SpawnerTransform, BuiltRotation, BuiltScale, ChunkTransforms);
+		}
+		FillChunkHISM(Chunk, ChunkTransforms, TargetMesh);
+	}
+
+	// 3. combine on workers, upload back on the game thread
+	if (Jobs->Num() > 0)
+	{
+		TWeakObjectPtr<AAGlobalSeatManager> WeakThis(this);
+		const FRotator SeatRotation = BuiltRotation;
+		const FVector SeatScale = BuiltScale;
+		UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis, Jobs, SeatRotation, SeatScale]()
+		{
+			ParallelFor(Jobs->Num(), [&Jobs, &SeatRotation, &SeatScale](int32 JobIdx)
+			{
+				FSeatCombineJob& Job = (*Jobs)[JobIdx];
+				CombineChunkTransforms(Job.Seats, Job.SpawnerTransform, SeatRotation, SeatScale, Job.Transforms);
+			});
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, Jobs]()
+			{
+				AAGlobalSeatManager* Manager = WeakThis.Get();
+				if (!Manager) return;
+
+				int32 NumCommitted = 0;
+				for (const FSeatCombineJob& Job : *Jobs)
+				{
+					// chunk gone, dirty again or refilled since -> a newer result owns it
+					FSeatTransformChunk* Chunk = Manager->ChunkData.Find(Job.Spawner);
+					if (!Chunk || Chunk->bDirty || Chunk->PendingCombineSerial != Job.Serial)
+					{
+						continue;
+					}
+
+					Chunk->PendingCombineSerial = 0;
+					Manager->FillChunkHISM(*Chunk, Job.Transforms, Manager->BuiltSeatMesh.Get());
+					++NumCommitted;
+				}
+
+				UE_LOG(LogTemp, Log, TEXT("Seats async combine committed %d of %d chunks"), NumCommitted, Jobs->Num());
+			});
+		});
+	}
+
+	// 4. publish flat seats for the crowd
+	PublishSeatLayout();
+
+	UE_LOG(LogTemp, Log, TEXT("Seats rebuilt %d of %d chunks (%d async), %d instances in %.2f ms (%d requests), layout v%u %.1f KB"),
+		NumRefilled, ChunkData.Num(), Jobs->Num(), SeatLayout->Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0, NumRequests,
+		SeatLayout->Version, SeatLayout->GetAllocatedSize() / 1024.0);
+}
+
+void AAGlobalSeatManager::PublishSeatLayout()
+{
+	// whoever holds the old snapshot keeps it
+	const TSharedRef<FSeatLayout, ESPMode::ThreadSafe> NewLayout = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
+	CombineSeatLayout(*NewLayout, SeatLayoutSpawners);
+	NewLayout->Version = FSeatLayout::NextVersion();
+	SeatLayout = NewLayout;
+	StandsStats::UpdateSeatCounters(ReportedCounters, SeatLayout->Num(), ChunkData.Num());
+}
+
+bool AAGlobalSeatManager::PublishLoadedSeats()
+{
+	if (SeatLayout->Num() > 0 || ChunkData.Num() == 0) return false;
+
+	// what the saved HISMs were filled with
+	UpdateHISMVisuals();
+	for (TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
+	{
+		FSeatTransformChunk& Chunk = Pair.Value;
+		if (const AASeatSpawnerBase* Spawner = Cast<AASeatSpawnerBase>(Pair.Key.Get()))
+		{
+			Chunk.SpawnerTransform = Spawner->GetActorTransform();
+			Chunk.SpawnerTransform.SetScale3D(FVector(1.0f, 1.0f, 1.0f));
+		}
+		Chunk.bDirty = false;
 	}
+	PublishSeatLayout();
+
+	UE_LOG(LogTemp, Log, TEXT("Seats published from the level: %d seats, %d chunks, layout v%u"), SeatLayout->Num(), ChunkData.Num(), SeatLayout->Version);
+	return true;
+}
 
-	// 4. combine all Transforms
-	AllTransforms.Empty();
-	CombineTransforms(AllTransforms);
+void AAGlobalSeatManager::FillChunkHISM(FSeatTransformChunk& Chunk, const TArray<FTransform>& Transforms, UStaticMesh* TargetMesh)
+{
+	STANDS_SCOPE(STAT_Stands_FillSeatHISM);
 
-	// 5. add to HISM
-	if (AllTransforms.Num() > 0)
+	UHierarchicalInstancedStaticMeshComponent* HISM = FindOrCreateChunkHISM(Chunk);
+	HISM->ClearInstances();
+	if (TargetMesh != HISM->GetStaticMesh())
 	{
-		SeatGridHISM->SetVisibility(true);
-		SeatGridHISM->AddInstances(AllTransforms, false);
+		HISM->SetStaticMesh(TargetMesh);
 	}
-	else
+
+	// validate
+	const bool bHasInstances = (TargetMesh != nullptr && Transforms.Num() > 0);
+	HISM->SetVisibility(bHasInstances);
+	if (bHasInstances)
 	{
-		SeatGridHISM->SetVisibility(false);
+		// no tree rebuild inside AddInstances, build it on a worker instead
+		HISM->AddInstances(Transforms, false, false, false);
+		HISM->BuildTreeIfOutdated(true, false);
 	}
 }
 
-void AAGlobalSeatManager::CombineTransforms(TArray<FTransform>& OutTransforms)
+UHierarchicalInstancedStaticMeshComponent* AAGlobalSeatManager::FindOrCreateChunkHISM(FSeatTransformChunk& Chunk)
 {
+	if (Chunk.HISM && IsValid(Chunk.HISM) && Chunk.HISM->IsA<UStandsHISMComponent>())
+	{
+		return Chunk.HISM;
+	}
+	// plain HISM from an older save, it would be cooked with its instances
+	DestroyChunkHISM(Chunk);
 
-	const FVector IndividualScale = bUseDebugMesh ? FVector(0.5f) : FVector(1.0f); 
-	const FRotator IndividualRotation = bUseDebugMesh ? ConeRotationOffset : SeatRotationOffset;
+	// same space as SeatGridHISM had for the combined seats
+	UHierarchicalInstancedStaticMeshComponent* NewHISM = NewObject<UStandsHISMComponent>(this);
+	NewHISM->SetupAttachment(SeatGridHISM);
+	NewHISM->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	// FillChunkHISM builds the tree async
+	NewHISM->bAutoRebuildTreeOnInstanceChanges = false;
+	NewHISM->RegisterComponent();
+
+	// stop gizmo highlight
+	NewHISM->bSelectable = false;
+
+	Chunk.HISM = NewHISM;
+	return NewHISM;
+}
+
+void AAGlobalSeatManager::DestroyChunkHISM(FSeatTransformChunk& Chunk)
+{
+	if (Chunk.HISM && IsValid(Chunk.HISM))
+	{
+		Chunk.HISM->ClearInstances();
+		Chunk.HISM->DestroyComponent();
+	}
+	Chunk.HISM = nullptr;
+}
+
+void AAGlobalSeatManager::CombineChunkTransforms(const FSeatChunkLayout& Seats, const FTransform& SpawnerTransform, const FRotator& SeatRotation, const FVector& SeatScale, TArray<FTransform>& OutTransforms)
+{
+	STANDS_SCOPE(STAT_Stands_CombineTransforms);
+
+	OutTransforms.SetNumUninitialized(Seats.Num());
+	for (int32 i = 0; i < Seats.Num(); ++i)
+	{
+		OutTransforms[i] = FSeatLayout::MakeTransform(Seats.Positions[i], Seats.Yaws[i], SpawnerTransform, SeatRotation, SeatScale);
+	}
+
+	// z-order for tighter clusters. HISM instance order is not seat order anyway
+	TArray<int32> Order;
+	FSpatialOrder::SortByMorton(OutTransforms, Order);
+	FSpatialOrder::Permute(OutTransforms, Order);
+}
+
+void AAGlobalSeatManager::CombineSeatLayout(FSeatLayout& OutLayout, TArray<TWeakObjectPtr<AActor>>& OutSpawners) const
+{
+	STANDS_SCOPE(STAT_Stands_CombineSeatLayout);
+
+	OutLayout.Reset();
+	OutSpawners.Reset();
+	OutLayout.SeatRotation = BuiltRotation;
+	OutLayout.SeatScale = BuiltScale;
 
+	int32 NumSeats = 0;
 	for (const TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
 	{
-		if (AASeatSpawnerBase* Spawner = Cast<AASeatSpawnerBase>(Pair.Key.Get()))
+		NumSeats += Pair.Value.Seats.Num();
+	}
+	OutLayout.Positions.Reserve(NumSeats);
+	OutLayout.Yaws.Reserve(NumSeats);
+	OutLayout.SpawnerIds.Reserve(NumSeats);
+	OutLayout.Rows.Reserve(NumSeats);
+	OutLayout.Columns.Reserve(NumSeats);
+
+	for (const TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
+	{
+		// only spawners get seats, same as the HISMs
+		if (!Cast<AASeatSpawnerBase>(Pair.Key.Get())) continue;
+
+		OutLayout.AppendChunk(Pair.Value.Seats, Pair.Value.SpawnerTransform);
+		OutSpawners.Add(Pair.Key);
+	}
+}
+
+bool AAGlobalSeatManager::ApplyBakedData()
+{
+	STANDS_SCOPE(STAT_Stands_LoadBakedData);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> BakedSeats = BakedData ? BakedData->GetSeatLayout() : nullptr;
+	if (!BakedSeats.IsValid()) return false;
+	const FSeatLayout& Seats = *BakedSeats;
+
+	// spawners moved or regenerated since the bake, the level's own seats win
+	if (!HasCurrentBakedData())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: %s is older than the level's seats, bake it again"), *GetName(), *BakedData->GetName());
+		return false;
+	}
+
+	// whatever registered during load is replaced. async combines still in flight find no chunk of theirs
+	for (TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
+	{
+		DestroyChunkHISM(Pair.Value);
+	}
+	ChunkData.Reset();
+	bRebuildPending = false;
+	NumPendingRequests = 0;
+
+	// mesh from this manager, seat offsets as baked
+	UpdateHISMVisuals();
+	BuiltRotation = Seats.SeatRotation;
+	BuiltScale = Seats.SeatScale;
+
+	// AppendChunk keeps each spawner's seats together, in spawner id order
+	TArray<FTransform> ChunkTransforms;
+	SeatLayoutSpawners.Reset();
+	int32 First = 0;
+	for (int32 SpawnerId = 0; SpawnerId < Seats.SpawnerTransforms.Num(); ++SpawnerId)
+	{
+		int32 Last = First;
+		while (Last < Seats.Num() && Seats.SpawnerIds[Last] == SpawnerId)
 		{
-			const FRotator BaseRotation = Spawner->GetLocalForwardDirection().Rotation(); 
+			++Last;
+		}
+		const int32 Count = Last - First;
 
-			FTransform SpawnerWorldTransform = Spawner->GetActorTransform();
-			SpawnerWorldTransform.SetScale3D(FVector(1.0f, 1.0f, 1.0f));
+		// seats stay in the layout even if their spawner is gone, the crowd indexes them
+		AActor* Spawner = BakedData->ResolveSpawner(SpawnerId, GetWorld());
+		if (Spawner)
+		{
+			FSeatTransformChunk& Chunk = ChunkData.FindOrAdd(Spawner);
+			Chunk.Seats.Reset();
+			Chunk.Seats.Positions.Append(Seats.Positions.GetData() + First, Count);
+			Chunk.Seats.Yaws.Append(Seats.Yaws.GetData() + First, Count);
+			Chunk.Seats.Rows.Append(Seats.Rows.GetData() + First, Count);
+			Chunk.Seats.Columns.Append(Seats.Columns.GetData() + First, Count);
+			Chunk.SpawnerTransform = Seats.SpawnerTransforms[SpawnerId];
+			Chunk.bDirty = false;
+			Chunk.PendingCombineSerial = 0;
 
-			
-			for (const FTransform& RawTransform : Pair.Value.Transforms)
-			{
-				const FTransform FinalLocalTransform(
-					BaseRotation + IndividualRotation,
-					RawTransform.GetLocation(),
-					IndividualScale
-				);
-				OutTransforms.Add(FinalLocalTransform * SpawnerWorldTransform);
-			}
+			CombineChunkTransforms(Chunk.Seats, Chunk.SpawnerTransform, BuiltRotation, BuiltScale, ChunkTransforms);
+			FillChunkHISM(Chunk, ChunkTransforms, BuiltSeatMesh.Get());
 		}
+		SeatLayoutSpawners.Add(Spawner);
+		First = Last;
 	}
+
+	// publish under a new version. the crowd sees a new version and matches the seats by hash
+	const TSharedRef<FSeatLayout, ESPMode::ThreadSafe> NewLayout = MakeShared<FSeatLayout, ESPMode::ThreadSafe>(Seats);
+	NewLayout->Version = FSeatLayout::NextVersion();
+	SeatLayout = NewLayout;
+	bSeatLayoutFrozen = true;
+	StandsStats::UpdateSeatCounters(ReportedCounters, SeatLayout->Num(), ChunkData.Num());
+
+	UE_LOG(LogTemp, Log, TEXT("Seats loaded from %s: %d seats, %d spawners in %.2f ms"),
+		*BakedData->GetName(), Seats.Num(), ChunkData.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+uint32 AAGlobalSeatManager::HashLevelSeats() const
+{
+	// the chunks CombineSeatLayout stitches, in its order. SpawnerTransform and Built* are not saved, read the sources
+	uint32 Crc = 0;
+	for (const TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : ChunkData)
+	{
+		const AASeatSpawnerBase* Spawner = Cast<AASeatSpawnerBase>(Pair.Key.Get());
+		if (!Spawner) continue;
+
+		const FSeatChunkLayout& Seats = Pair.Value.Seats;
+		const FVector Location = Spawner->GetActorLocation();
+		const FQuat Rotation = Spawner->GetActorQuat();
+		Crc = FCrc::MemCrc32(&Location, sizeof(FVector), Crc);
+		Crc = FCrc::MemCrc32(&Rotation, sizeof(FQuat), Crc);
+		Crc = FCrc::MemCrc32(Seats.Positions.GetData(), Seats.Positions.Num() * sizeof(FVector3f), Crc);
+		Crc = FCrc::MemCrc32(Seats.Yaws.GetData(), Seats.Yaws.Num() * sizeof(uint16), Crc);
+	}
+
+	// what UpdateHISMVisuals builds with
+	const UStaticMesh* TargetMesh = bUseDebugMesh ? (DebugCone ? DebugCone->GetStaticMesh() : nullptr) : SeatMesh;
+	const FRotator Rotation = bUseDebugMesh ? ConeRotationOffset : SeatRotationOffset;
+	Crc = FCrc::StrCrc32(*GetPathNameSafe(TargetMesh), Crc);
+	Crc = FCrc::MemCrc32(&Rotation, sizeof(FRotator), Crc);
+	return HashCombine(Crc, GetTypeHash(bUseDebugMesh));
+}
+
+bool AAGlobalSeatManager::HasCurrentBakedData() const
+{
+	return BakedData && BakedData->NumSeats > 0 && BakedData->LevelSeatsHash == HashLevelSeats();
 }
 
 void AAGlobalSeatManager::TellSeatSpawnersToConstruct(AASeatSpawnerBase* Spawner)
@@ -156,11 +584,203 @@ void AAGlobalSeatManager::TellSeatSpawnersToConstruct(AASeatSpawnerBase* Spawner
 	}
 }
 
+void AAGlobalSeatManager::RegenerateAllSeats()
+{
+	UWorld* World = GetWorld();
+	if (!World) return;
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumSpawners = 0;
+	{
+		FScopedSeatUpdate SeatUpdate(this);
+		for (TActorIterator<AASeatSpawnerBase> It(World); It; ++It)
+		{
+			if (It->SeatManager != this) continue;
+			It->RegenerateSeats();
+			++NumSpawners;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Seats regenerated %d spawners natively in %.2f ms"), NumSpawners, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+#if !UE_BUILD_SHIPPING
+
+// Stands.BenchRegenerate [Runs]
+// every seat manager in the world: native RegenerateAllSeats vs rerunning each spawner's construction script.
+// one warm-up of each first, not counted. the order alternates per run so neither side always gets the warm caches
+static void BenchRegenerate(const TArray<FString>& Args, UWorld* World)
+{
+	if (!World) return;
+
+	const int32 NumRuns = Args.Num() > 0 ? FMath::Max(2, FCString::Atoi(*Args[0])) : 4;
+
+	for (TActorIterator<AAGlobalSeatManager> ManagerIt(World); ManagerIt; ++ManagerIt)
+	{
+		AAGlobalSeatManager* Manager = *ManagerIt;
+
+		TArray<AASeatSpawnerBase*> Spawners;
+		for (TActorIterator<AASeatSpawnerBase> It(World); It; ++It)
+		{
+			if (It->SeatManager == Manager) Spawners.Add(*It);
+		}
+
+		auto RunNative = [Manager]()
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			Manager->RegenerateAllSeats();
+			return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		};
+		auto RunScripts = [Manager, &Spawners]()
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			{
+				FScopedSeatUpdate SeatUpdate(Manager);
+				for (AASeatSpawnerBase* Spawner : Spawners)
+				{
+					Spawner->RerunConstructionScripts();
+				}
+			}
+			return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		};
+
+		// warm-up
+		RunNative();
+		RunScripts();
+
+		double NativeMs = 0.0;
+		double ScriptMs = 0.0;
+		for (int32 Run = 0; Run < NumRuns; ++Run)
+		{
+			if (Run % 2 == 0)
+			{
+				NativeMs += RunNative();
+				ScriptMs += RunScripts();
+			}
+			else
+			{
+				ScriptMs += RunScripts();
+				NativeMs += RunNative();
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("BenchRegenerate %s, %d spawners, %d seats, %d runs: native %.2f ms, construction scripts %.2f ms (mean)"),
+			*Manager->GetName(), Spawners.Num(), Manager->GetSeatLayout()->Num(), NumRuns, NativeMs / NumRuns, ScriptMs / NumRuns);
+	}
+}
+
+static FAutoConsoleCommand BenchRegenerateCmd(
+	TEXT("Stands.BenchRegenerate"),
+	TEXT("Time native seat regeneration against rerunning the spawners' construction scripts, alternating order after a warm-up. Arg: runs (default 4)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchRegenerate));
+
+// Stands.BenchLevelOpen [Runs]
+// the registrations of a level open, every spawner of every seat manager in the world: a rebuild per
+// registration like before the end of frame coalescing, vs all registrations and one flush. same warm-up
+// and alternating order as BenchRegenerate. the flush is synchronous here, the level open's combine may be async
+static void BenchLevelOpen(const TArray<FString>& Args, UWorld* World)
+{
+	if (!World) return;
+
+	const int32 NumRuns = Args.Num() > 0 ? FMath::Max(2, FCString::Atoi(*Args[0])) : 4;
+
+	for (TActorIterator<AAGlobalSeatManager> ManagerIt(World); ManagerIt; ++ManagerIt)
+	{
+		AAGlobalSeatManager* Manager = *ManagerIt;
+		if (Manager->IsSeatLayoutFrozen()) continue;
+
+		// the seats each spawner registers, generated once
+		TArray<AASeatSpawnerBase*> Spawners;
+		TArray<FSeatChunkLayout> SpawnerSeats;
+		for (TActorIterator<AASeatSpawnerBase> It(World); It; ++It)
+		{
+			if (It->SeatManager != Manager) continue;
+			Spawners.Add(*It);
+			It->GenerateSeatLayout(SpawnerSeats.AddDefaulted_GetRef());
+		}
+		if (Spawners.Num() == 0) continue;
+
+		auto RunPerRegistration = [Manager, &Spawners, &SpawnerSeats]()
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Spawners.Num(); ++i)
+			{
+				Manager->RegisterSeatLayout(Spawners[i], FSeatChunkLayout(SpawnerSeats[i]));
+				Manager->FlushSeatUpdates();
+			}
+			return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		};
+		auto RunCoalesced = [Manager, &Spawners, &SpawnerSeats]()
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Spawners.Num(); ++i)
+			{
+				Manager->RegisterSeatLayout(Spawners[i], FSeatChunkLayout(SpawnerSeats[i]));
+			}
+			Manager->FlushSeatUpdates();
+			return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		};
+
+		// warm-up
+		RunPerRegistration();
+		RunCoalesced();
+
+		double PerRegistrationMs = 0.0;
+		double CoalescedMs = 0.0;
+		for (int32 Run = 0; Run < NumRuns; ++Run)
+		{
+			if (Run % 2 == 0)
+			{
+				PerRegistrationMs += RunPerRegistration();
+				CoalescedMs += RunCoalesced();
+			}
+			else
+			{
+				CoalescedMs += RunCoalesced();
+				PerRegistrationMs += RunPerRegistration();
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("BenchLevelOpen %s, %d spawners, %d seats, %d runs: rebuild per registration %.2f ms, coalesced %.2f ms (mean)"),
+			*Manager->GetName(), Spawners.Num(), Manager->GetSeatLayout()->Num(), NumRuns, PerRegistrationMs / NumRuns, CoalescedMs / NumRuns);
+	}
+}
+
+static FAutoConsoleCommand BenchLevelOpenCmd(
+	TEXT("Stands.BenchLevelOpen"),
+	TEXT("Time a level open's seat registrations with a rebuild per registration against one coalesced flush, alternating order after a warm-up. Arg: runs (default 4)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchLevelOpen));
+
+#endif
+
 // Called when the game starts or when spawned
 void AAGlobalSeatManager::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// cooked levels skip seat generation
+	if (BakedData && GetWorld() && GetWorld()->IsGameWorld() && ApplyBakedData())
+	{
+		return;
+	}
+
+	// no baked seats: the crowd still needs a snapshot of the seats saved in the level
+	PublishLoadedSeats();
+}
+
+void AAGlobalSeatManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CancelEndFrameFlush();
+	StandsStats::UpdateSeatCounters(ReportedCounters, 0, 0);
+	Super::EndPlay(EndPlayReason);
+}
+
+void AAGlobalSeatManager::BeginDestroy()
+{
+	// editor worlds never EndPlay
+	CancelEndFrameFlush();
+	StandsStats::UpdateSeatCounters(ReportedCounters, 0, 0);
+	Super::BeginDestroy();
 }
 
 // Called every frame
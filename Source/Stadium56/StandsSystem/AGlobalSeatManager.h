@@ -6,15 +6,35 @@
 #include "GameFramework/Actor.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "StandsSystem/SeatLayout.h"
+#include "StandsSystem/StandsStats.h"
 #include "AGlobalSeatManager.generated.h"
 
+class AASeatSpawnerBase;
+class UStandsBakedData;
+
 USTRUCT()
 struct FSeatTransformChunk
 {
 	GENERATED_BODY()
 
+	// spawner local seats
+	UPROPERTY()
+	FSeatChunkLayout Seats;
+
+	// spawner transform at the last refill, scale 1
+	UPROPERTY(Transient)
+	FTransform SpawnerTransform;
+
+	// own HISM, so editing one spawner leaves the others' instances and cluster trees alone
 	UPROPERTY()
-	TArray<FTransform> Transforms;
+	UHierarchicalInstancedStaticMeshComponent* HISM = nullptr;
+
+	// Seats changed since HISM was filled
+	bool bDirty = true;
+
+	// async combine in flight for this chunk, 0 if none. only that serial may fill the HISM
+	uint32 PendingCombineSerial = 0;
 };
 
 UCLASS(meta = (PrioritizeCategories = "Parm"))
@@ -25,16 +45,52 @@ class STADIUM56_API AAGlobalSeatManager : public AActor
 public:	
 	// Sets default values for this actor's properties
 	AAGlobalSeatManager();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void BeginDestroy() override;
 
 	// called by ASeatSpawner to register Transforms
 	UFUNCTION(BlueprintCallable, Category = "Parm")
 	void RegisterSeatChunk(AActor* Spawner, const TArray<FTransform>& RawTransforms);
 
+	// native path, no FTransforms on the way in
+	void RegisterSeatLayout(AActor* Spawner, FSeatChunkLayout&& Seats);
+
 	// remove from manager when destroyed
 	void UnregisterSeatChunk(AActor* Spawner);
 
-	// all called seat transforms
-	TArray<FTransform> AllTransforms;
+	// batch chunk changes. the outermost EndSeatUpdate rebuilds once
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void BeginSeatUpdate();
+
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void EndSeatUpdate();
+
+	// RegenerateSeats on every spawner hooked to this manager, one rebuild at the end.
+	// native, construction scripts don't run
+	UFUNCTION(BlueprintCallable, Category = "Parm", meta = (CallInEditor = "true"))
+	void RegenerateAllSeats();
+
+	// rebuild now if chunks changed since the last rebuild. call before GetSeatLayout
+	void FlushSeatUpdates();
+
+	// all registered seats, compact. GetTransform(i) is what the HISMs show.
+	// game thread only, the returned snapshot can go anywhere
+	FSeatLayoutRef GetSeatLayout() const { return SeatLayout; }
+	uint32 GetSeatLayoutVersion() const { return SeatLayout->Version; }
+
+	// owner of each spawner id in GetSeatLayout(). null once an actor is gone
+	const TArray<TWeakObjectPtr<AActor>>& GetSeatLayoutSpawners() const { return SeatLayoutSpawners; }
+
+	// seats came from BakedData, spawner registrations are ignored
+	bool IsSeatLayoutFrozen() const { return bSeatLayoutFrozen; }
+
+	UStandsBakedData* GetBakedData() const { return BakedData; }
+
+	// the saved chunks, their spawners' transforms and the seat settings. what BakedData is checked against
+	uint32 HashLevelSeats() const;
+
+	// BakedData holds seats baked from the level as it is now
+	bool HasCurrentBakedData() const;
 
 protected:
 	// Called when the game starts or when spawned
@@ -43,6 +99,7 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	USceneComponent* DefaultSceneRoot;
 
+	// parent of the per-spawner HISMs, holds no instances itself
 	UPROPERTY(BlueprintReadWrite)
 	UHierarchicalInstancedStaticMeshComponent* SeatGridHISM;
 
@@ -52,6 +109,16 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Seat")
 	FRotator SeatRotationOffset;
 
+	// end of frame rebuilds combine transforms on worker threads, only the HISM upload is on the game thread.
+	// FlushSeatUpdates and RebuildHISMs stay synchronous
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Seat")
+	bool bAsyncSeatRebuild;
+
+	// frozen seats for game worlds, uploaded at BeginPlay instead of running the spawners.
+	// written by the crowd manager's BakeAndFreeze
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Bake")
+	UStandsBakedData* BakedData;
+
 	// debug cone
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Parm|Debug")
 	UStaticMeshComponent* DebugCone;
@@ -62,7 +129,7 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Debug")
 	FRotator ConeRotationOffset;
 
-	// clean and rebuild
+	// clean and rebuild every spawner's seats
 	UFUNCTION(BlueprintCallable, Category = "Parm")
 	void RebuildHISMs();
 
@@ -75,14 +142,87 @@ private:
 	UPROPERTY()
 	TMap<TWeakObjectPtr<AActor>, FSeatTransformChunk> ChunkData;
 
-	// internal, set seat vs cone
+	// internal, set seat vs cone. dirties every chunk when it changes
 	void UpdateHISMVisuals();
 
-	// conbine and apply BP global transforms
-	void CombineTransforms(TArray<FTransform>& OutTransforms);
+	// refill the HISMs of dirty chunks, then restitch SeatLayout.
+	// bAsyncCombine: the HISMs are filled once the worker is done, SeatLayout right away
+	void UpdateChunkHISMs(bool bAsyncCombine = false);
+
+	// clear and refill one chunk's HISM, game thread
+	void FillChunkHISM(FSeatTransformChunk& Chunk, const TArray<FTransform>& Transforms, UStaticMesh* TargetMesh);
+
+	UHierarchicalInstancedStaticMeshComponent* FindOrCreateChunkHISM(FSeatTransformChunk& Chunk);
+	void DestroyChunkHISM(FSeatTransformChunk& Chunk);
+
+	// what the chunk HISMs were last filled with
+	TWeakObjectPtr<UStaticMesh> BuiltSeatMesh;
+	FRotator BuiltRotation = FRotator::ZeroRotator;
+	FVector BuiltScale = FVector::OneVector;
+
+	// mark dirty. rebuild at end of frame unless a batch is open
+	void RequestRebuild();
+	void OnEndFrameFlush();
+
+	// drop the end of frame rebuild, the delegate must not outlive this manager
+	void CancelEndFrameFlush();
+
+	int32 SeatUpdateDepth = 0;
+	bool bRebuildPending = false;
+	// requests folded into the next rebuild, for the log
+	int32 NumPendingRequests = 0;
+	FDelegateHandle EndFrameFlushHandle;
+
+	// last async combine launched
+	uint32 CombineSerial = 0;
+
+	// conbine and apply BP global transforms of one chunk into OutTransforms, morton ordered. only built for the HISM, any thread
+	static void CombineChunkTransforms(const FSeatChunkLayout& Seats, const FTransform& SpawnerTransform, const FRotator& SeatRotation, const FVector& SeatScale, TArray<FTransform>& OutTransforms);
+
+	friend class FStandsBenchmark;
+	friend class FStandsMemReport;
+
+	// stitch all chunks' seats. OutSpawners[i] owns spawner id i
+	void CombineSeatLayout(FSeatLayout& OutLayout, TArray<TWeakObjectPtr<AActor>>& OutSpawners) const;
+
+	// current snapshot, replaced (never modified) by every rebuild
+	FSeatLayoutRef SeatLayout = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
+	TArray<TWeakObjectPtr<AActor>> SeatLayoutSpawners;
+
+	// CombineSeatLayout into a new snapshot and publish it
+	void PublishSeatLayout();
+
+	// loaded level: chunks and their HISMs are saved, the snapshot is not. publish the saved seats, no refill.
+	// false if there was nothing to publish
+	bool PublishLoadedSeats();
+
+	// replace every chunk with BakedData's seats and publish them. false if there is nothing to load
+	bool ApplyBakedData();
+	bool bSeatLayoutFrozen = false;
+
+	// this manager's share of stat Stands
+	StandsStats::FSeatCounters ReportedCounters;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
 };
+
+// Begin/EndSeatUpdate for a scope
+struct FScopedSeatUpdate
+{
+	explicit FScopedSeatUpdate(AAGlobalSeatManager* InManager)
+		: Manager(InManager)
+	{
+		if (Manager) Manager->BeginSeatUpdate();
+	}
+
+	~FScopedSeatUpdate()
+	{
+		if (Manager) Manager->EndSeatUpdate();
+	}
+
+private:
+	AAGlobalSeatManager* Manager;
+};
@@ -2,7 +2,13 @@
 
 
 #include "StandsSystem/ASeatSpawnerBase.h"
+#include "StandsSystem/StandsStats.h"
 #include "StandsSystem/AGlobalSeatManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "Tasks/Task.h"
+#include "Misc/AutomationTest.h"
 
 // Deprecated
 /**
@@ -56,6 +62,244 @@ static void FindVerticalScanlineIntersections(float ScanlineX,
 	}
 }
 
+// one polygon edge. keep Vi/Vj in polygon order so the math matches the function above bit for bit
+struct FScanlineEdge
+{
+	FVector2D Vi;
+	FVector2D Vj;
+	double MinX;
+	double MaxX;
+};
+
+// active edge table for ascending vertical scanlines.
+// an edge is live while MinX <= ScanlineX < MaxX, same as the odd-even test above
+class FActiveEdgeScanline
+{
+public:
+	explicit FActiveEdgeScanline(const TArray<FVector2D>& PolygonVertices)
+	{
+		const int32 NumVerts = PolygonVertices.Num();
+		if (NumVerts < 3)
+		{
+			return;
+		}
+
+		Edges.Reserve(NumVerts);
+		for (int32 i = 0, j = NumVerts - 1; i < NumVerts; j = i++)
+		{
+			const FVector2D& Vi = PolygonVertices[i];
+			const FVector2D& Vj = PolygonVertices[j];
+
+			// parallel to scanline, never crossed
+			if (Vi.X == Vj.X) continue;
+
+			FScanlineEdge& Edge = Edges.AddDefaulted_GetRef();
+			Edge.Vi = Vi;
+			Edge.Vj = Vj;
+			Edge.MinX = FMath::Min(Vi.X, Vj.X);
+			Edge.MaxX = FMath::Max(Vi.X, Vj.X);
+		}
+
+		// edge insertion order
+		Edges.Sort([](const FScanlineEdge& A, const FScanlineEdge& B) { return A.MinX < B.MinX; });
+	}
+
+	// sorted Y intersections of the next scanline. ScanlineX must not decrease between calls
+	void Advance(float ScanlineX, TArray<float>& OutYIntersections)
+	{
+		// 1. drop edges the scanline has passed, keep the order
+		int32 NumKept = 0;
+		for (int32 k = 0; k < ActiveEdges.Num(); ++k)
+		{
+			if (Edges[ActiveEdges[k]].MaxX > ScanlineX)
+			{
+				ActiveEdges[NumKept++] = ActiveEdges[k];
+			}
+		}
+		ActiveEdges.SetNum(NumKept, EAllowShrinking::No);
+
+		// 2. pick up edges that start at or before this scanline
+		while (NextEdge < Edges.Num() && Edges[NextEdge].MinX <= ScanlineX)
+		{
+			if (Edges[NextEdge].MaxX > ScanlineX)
+			{
+				ActiveEdges.Add(NextEdge);
+			}
+			++NextEdge;
+		}
+
+		// 3. intersect. list is still ordered from last row, so insertion sort is ~linear
+		ActiveY.Reset();
+		for (int32 k = 0; k < ActiveEdges.Num(); ++k)
+		{
+			const int32 EdgeIdx = ActiveEdges[k];
+			const FScanlineEdge& Edge = Edges[EdgeIdx];
+			const FVector2D& Vi = Edge.Vi;
+			const FVector2D& Vj = Edge.Vj;
+			const float IntersectY = (Vj.Y - Vi.Y) * (ScanlineX - Vi.X) / (Vj.X - Vi.X) + Vi.Y;
+
+			int32 Slot = k;
+			ActiveY.Add(IntersectY);
+			while (Slot > 0 && ActiveY[Slot - 1] > IntersectY)
+			{
+				ActiveY[Slot] = ActiveY[Slot - 1];
+				ActiveEdges[Slot] = ActiveEdges[Slot - 1];
+				--Slot;
+			}
+			ActiveY[Slot] = IntersectY;
+			ActiveEdges[Slot] = EdgeIdx;
+		}
+
+		OutYIntersections.Append(ActiveY);
+	}
+
+private:
+	// sorted by MinX
+	TArray<FScanlineEdge> Edges;
+	int32 NextEdge = 0;
+
+	// indices into Edges, ordered by Y of the last scanline
+	TArray<int32> ActiveEdges;
+	TArray<float> ActiveY;
+};
+
+#if !UE_BUILD_SHIPPING || WITH_DEV_AUTOMATION_TESTS
+// wobbly bowl outline, non convex, several enter/exit pairs per row
+static void MakeWobblyOutline(int32 NumVerts, double Radius, TArray<FVector2D>& OutPolygon)
+{
+	OutPolygon.Reset(NumVerts);
+	for (int32 i = 0; i < NumVerts; ++i)
+	{
+		const double Angle = 2.0 * PI * i / NumVerts;
+		const double R = Radius * (1.0 + 0.15 * FMath::Sin(7.0 * Angle));
+		OutPolygon.Add(FVector2D(R * FMath::Cos(Angle), R * FMath::Sin(Angle)));
+	}
+}
+#endif
+
+#if !UE_BUILD_SHIPPING
+// Stands.BenchScanline [Rows]
+// per-row edge loop + sort vs active edge table, on wobbly bowl outlines of 4..4000 verts
+static void BenchScanline(const TArray<FString>& Args)
+{
+	const int32 NumRows = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 2000;
+	const double Radius = 20000.0;
+	const float Spacing = static_cast<float>(2.3 * Radius / NumRows);
+	const int32 VertexCounts[] = { 4, 16, 64, 256, 1000, 4000 };
+
+	TArray<FVector2D> Polygon;
+	TArray<float> RowY;
+	TArray<float> OldY;
+	TArray<float> NewY;
+
+	for (const int32 NumVerts : VertexCounts)
+	{
+		MakeWobblyOutline(NumVerts, Radius, Polygon);
+
+		const int32 MaxRow = NumRows / 2;
+		const int32 MinRow = -MaxRow;
+
+		// old path
+		OldY.Reset();
+		const double OldStart = FPlatformTime::Seconds();
+		for (int32 Row = MinRow; Row <= MaxRow; ++Row)
+		{
+			RowY.Reset();
+			FindVerticalScanlineIntersections(Row * Spacing, Polygon, RowY);
+			RowY.Sort();
+			OldY.Append(RowY);
+		}
+		const double OldMs = (FPlatformTime::Seconds() - OldStart) * 1000.0;
+
+		// active edge table
+		NewY.Reset();
+		const double NewStart = FPlatformTime::Seconds();
+		FActiveEdgeScanline Scanline(Polygon);
+		for (int32 Row = MinRow; Row <= MaxRow; ++Row)
+		{
+			Scanline.Advance(Row * Spacing, NewY);
+		}
+		const double NewMs = (FPlatformTime::Seconds() - NewStart) * 1000.0;
+
+		UE_LOG(LogTemp, Log, TEXT("BenchScanline %4d verts %d rows: per-row %.3f ms, AET %.3f ms (x%.1f) %s"),
+			NumVerts, MaxRow - MinRow + 1, OldMs, NewMs, NewMs > 0.0 ? OldMs / NewMs : 0.0,
+			OldY == NewY ? TEXT("match") : TEXT("MISMATCH"));
+	}
+}
+
+static FAutoConsoleCommand BenchScanlineCmd(
+	TEXT("Stands.BenchScanline"),
+	TEXT("Compare per-row and active-edge-table seat scanlines. Arg: row count (default 2000)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchScanline));
+#endif
+
+#if WITH_DEV_AUTOMATION_TESTS
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStandsScanlineTest, "Stands.Seats.Scanline",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+// the active edge table gives the per-row intersections, sorted, bit for bit
+bool FStandsScanlineTest::RunTest(const FString& Parameters)
+{
+	struct FCase
+	{
+		FString Name;
+		TArray<FVector2D> Polygon;
+	};
+
+	TArray<FCase> Cases;
+	for (const int32 NumVerts : { 3, 4, 16, 257, 4000 })
+	{
+		FCase& Case = Cases.AddDefaulted_GetRef();
+		Case.Name = FString::Printf(TEXT("wobbly %d"), NumVerts);
+		MakeWobblyOutline(NumVerts, 20000.0, Case.Polygon);
+	}
+
+	// vertices and vertical edges right on the scanlines, and a comb with many pairs per row
+	Cases.Add({ TEXT("grid square"), { FVector2D(-4, -4), FVector2D(4, -4), FVector2D(4, 4), FVector2D(-4, 4) } });
+	Cases.Add({ TEXT("grid diamond"), { FVector2D(0, -5), FVector2D(5, 0), FVector2D(0, 5), FVector2D(-5, 0) } });
+	FCase& Comb = Cases.AddDefaulted_GetRef();
+	Comb.Name = TEXT("comb");
+	for (int32 Tooth = 0; Tooth < 8; ++Tooth)
+	{
+		Comb.Polygon.Add(FVector2D(Tooth * 2, 0));
+		Comb.Polygon.Add(FVector2D(Tooth * 2 + 0.5, 10));
+		Comb.Polygon.Add(FVector2D(Tooth * 2 + 1, 1));
+	}
+	Comb.Polygon.Add(FVector2D(16, 0));
+	Comb.Polygon.Add(FVector2D(16, -1));
+	Comb.Polygon.Add(FVector2D(0, -1));
+
+	TArray<float> RowY;
+	TArray<float> OldY;
+	TArray<float> NewY;
+	for (const FCase& Case : Cases)
+	{
+		FBox2D Bounds(Case.Polygon);
+		const double Spacing = FMath::Max(Bounds.GetSize().X / 200.0, 0.25);
+		const int32 MinRow = FMath::FloorToInt32(Bounds.Min.X / Spacing) - 1;
+		const int32 MaxRow = FMath::CeilToInt32(Bounds.Max.X / Spacing) + 1;
+
+		OldY.Reset();
+		NewY.Reset();
+		FActiveEdgeScanline Scanline(Case.Polygon);
+		for (int32 Row = MinRow; Row <= MaxRow; ++Row)
+		{
+			const float ScanlineX = static_cast<float>(Row * Spacing);
+			RowY.Reset();
+			FindVerticalScanlineIntersections(ScanlineX, Case.Polygon, RowY);
+			RowY.Sort();
+			OldY.Append(RowY);
+			Scanline.Advance(ScanlineX, NewY);
+		}
+
+		TestTrue(FString::Printf(TEXT("%s: intersections found"), *Case.Name), OldY.Num() > 0);
+		TestEqual(FString::Printf(TEXT("%s: intersection count"), *Case.Name), NewY.Num(), OldY.Num());
+		TestTrue(FString::Printf(TEXT("%s: same intersections"), *Case.Name), OldY == NewY);
+	}
+	return true;
+}
+#endif
+
 // Sets default values
 AASeatSpawnerBase::AASeatSpawnerBase()
 {
@@ -129,53 +373,131 @@ void AASeatSpawnerBase::UpdateAndValidateSpline()
 }
 
 
-TArray<FTransform> AASeatSpawnerBase::GenerateTransforms()
+bool AASeatSpawnerBase::MakeSeatGenerationInput(FSeatGenerationInput& OutInput) const
 {
-	// save the transforms
-	TArray<FTransform> GeneratedTransforms;
-
 	// 2D spline points
-	TArray<FVector2D> SplinePoints2D;
+	OutInput.Polygon.Reset();
 	// spline bounds 3d
-	FBox SplineBounds(ForceInit);
+	OutInput.Bounds = FBox(ForceInit);
 
 	if (!SeatSpline || SeatSpline->GetNumberOfSplinePoints() <= 2)
 	{
-		return GeneratedTransforms; // return empty
+		return false; // return empty
 	}
 
 	// spline is root so actor scale = spline scale
 	const FVector ActorScale = GetActorScale3D();
 
 	const int32 NumSplinePoints = SeatSpline->GetNumberOfSplinePoints(); //ordered
+	OutInput.Polygon.Reserve(NumSplinePoints);
 	for (int32 i = 0; i < NumSplinePoints; ++i)
 	{
 		const FVector Location3D = SeatSpline->GetLocationAtSplinePoint(i, ESplineCoordinateSpace::Local);
 		const FVector Location3D_Scaled = Location3D * ActorScale;
-		SplinePoints2D.Add(FVector2D(Location3D_Scaled.X, Location3D_Scaled.Y));
+		OutInput.Polygon.Add(FVector2D(Location3D_Scaled.X, Location3D_Scaled.Y));
 		// add pt to bounds
-		SplineBounds += Location3D_Scaled;
+		OutInput.Bounds += Location3D_Scaled;
 	}
 
+	// every seat faces the same way
+	OutInput.Yaw = FSeatLayout::QuantizeYaw(LocalForwardDirection.Rotation().Yaw);
+	OutInput.RowSpacing = RowSpacing;
+	OutInput.ColumnSpacing = ColumnSpacing;
+	return true;
+}
 
-	const FRotator BaseRotation = LocalForwardDirection.Rotation();
+// the scan itself. touches no actor, so it runs on any thread
+bool AASeatSpawnerBase::GenerateSeats(const FSeatGenerationInput& Input, FSeatChunkLayout& OutSeats)
+{
+	STANDS_SCOPE(STAT_Stands_GenerateSeats);
 
-	// save the intersections of a row and the spline
-	TArray<float> YIntersections;
+	OutSeats.Reset();
+
+	const TArray<FVector2D>& SplinePoints2D = Input.Polygon;
+	const FBox& SplineBounds = Input.Bounds;
+	const float RowSpacing = Input.RowSpacing;
+	const float ColumnSpacing = Input.ColumnSpacing;
+	const uint16 BaseYaw = Input.Yaw;
+	if (SplinePoints2D.Num() <= 2 || !SplineBounds.IsValid)
+	{
+		return false;
+	}
 
 	//// AABB to get row index range
 	const int32 MinRow = FMath::FloorToInt(SplineBounds.Min.X / RowSpacing);
 	const int32 MaxRow = FMath::CeilToInt(SplineBounds.Max.X / RowSpacing);
+	const int32 NumRows = MaxRow - MinRow + 1;
+	if (NumRows <= 0)
+	{
+		return false;
+	}
 
 	// Calculate Z offset
 	const float TotalHeight = SplineBounds.Max.Z;
 	const float SplineXSize = SplineBounds.GetSize().X;
 
-	for (int32 Row = MinRow; Row <= MaxRow; ++Row)
+	// 1. scan. cheap and sequential, the edge table walks rows in ascending X
+	// intersections of all rows packed together, row r owns [RowYStart[r], RowYStart[r + 1])
+	TArray<float> YIntersections;
+	TArray<int32> RowYStart;
+	RowYStart.SetNumUninitialized(NumRows + 1);
+	FActiveEdgeScanline Scanline(SplinePoints2D);
+	for (int32 RowIdx = 0; RowIdx < NumRows; ++RowIdx)
+	{
+		RowYStart[RowIdx] = YIntersections.Num();
+		const float ScanlineX = (MinRow + RowIdx) * RowSpacing;
+		// already sorted
+		Scanline.Advance(ScanlineX, YIntersections);
+	}
+	RowYStart[NumRows] = YIntersections.Num();
+
+	// 2. count seats per row, rows are independent now
+	TArray<int32> RowSeatOffset;
+	RowSeatOffset.SetNumZeroed(NumRows + 1);
+	ParallelFor(NumRows, [&](int32 RowIdx)
+	{
+		const int32 YStart = RowYStart[RowIdx];
+		const int32 YEnd = RowYStart[RowIdx + 1];
+		if (YEnd - YStart < 2)
+		{
+			return; // no intersections
+		}
+
+		int32 Count = 0;
+		// fill inside. odd-even rule
+		for (int32 i = YStart; i + 1 < YEnd; i += 2)
+		{
+			// AABB to get column index range
+			const int32 MinCol = FMath::CeilToInt(YIntersections[i] / ColumnSpacing);
+			const int32 MaxCol = FMath::FloorToInt(YIntersections[i + 1] / ColumnSpacing);
+			Count += FMath::Max(0, MaxCol - MinCol + 1);
+		}
+		RowSeatOffset[RowIdx + 1] = Count;
+	});
+
+	// 3. prefix sum -> where each row writes
+	for (int32 RowIdx = 0; RowIdx < NumRows; ++RowIdx)
+	{
+		RowSeatOffset[RowIdx + 1] += RowSeatOffset[RowIdx];
+	}
+	const int32 NumSeats = RowSeatOffset[NumRows];
+	if (NumSeats == 0)
 	{
-		YIntersections.Reset(); //clear previous row
+		return false;
+	}
 
-		const float ScanlineX = Row * RowSpacing;
+	// 4. scatter. same order as the old row by row loop
+	OutSeats.SetNumUninitialized(NumSeats);
+	ParallelFor(NumRows, [&](int32 RowIdx)
+	{
+		const int32 YStart = RowYStart[RowIdx];
+		const int32 YEnd = RowYStart[RowIdx + 1];
+		if (YEnd - YStart < 2)
+		{
+			return;
+		}
+
+		const float ScanlineX = (MinRow + RowIdx) * RowSpacing;
 		float Z_Height = 0.0f;
 		if (SplineXSize > KINDA_SMALL_NUMBER) 
 		{
@@ -183,36 +505,116 @@ TArray<FTransform> AASeatSpawnerBase::GenerateTransforms()
 			const float Alpha = (ScanlineX - SplineBounds.Min.X) / SplineXSize;
 			Z_Height = FMath::Lerp(0.0f, TotalHeight, Alpha);
 		}
-		FindVerticalScanlineIntersections(ScanlineX, SplinePoints2D, YIntersections);
 
-		if (YIntersections.Num() < 2)
-		{
-			continue; // no intersections
-		}
-
-		YIntersections.Sort();
-
-		// fill inside. odd-even rule
-		for (int32 i = 0; i < YIntersections.Num(); i += 2)
+		const int16 Row = FSeatLayout::ClampRowColumn(MinRow + RowIdx);
+		int32 OutIdx = RowSeatOffset[RowIdx];
+		for (int32 i = YStart; i + 1 < YEnd; i += 2)
 		{
 			const float Y_Enter = YIntersections[i];
 			const float Y_Exit = YIntersections[i + 1];
 
-			// AABB to get column index range
 			const int32 MinCol = FMath::CeilToInt(Y_Enter / ColumnSpacing);
 			const int32 MaxCol = FMath::FloorToInt(Y_Exit / ColumnSpacing);
-			//for (int32 Col = 0; Col < 5; ++Col)
 			for (int32 Col = MinCol; Col <= MaxCol; ++Col)
 			{
 				const float SeatY = Col * ColumnSpacing;
 
-				const FVector FinalPosition(ScanlineX, SeatY, Z_Height);
-				const FTransform InstanceTransform(BaseRotation, FinalPosition);
-				GeneratedTransforms.Add(InstanceTransform);
+				OutSeats.Positions[OutIdx] = FVector3f(ScanlineX, SeatY, Z_Height);
+				OutSeats.Yaws[OutIdx] = BaseYaw;
+				OutSeats.Rows[OutIdx] = Row;
+				OutSeats.Columns[OutIdx] = FSeatLayout::ClampRowColumn(Col);
+				++OutIdx;
 			}
 		}
+	});
+
+	return true;
+}
+
+bool AASeatSpawnerBase::GenerateSeatLayout(FSeatChunkLayout& OutSeats) const
+{
+	FSeatGenerationInput Input;
+	if (!MakeSeatGenerationInput(Input))
+	{
+		OutSeats.Reset();
+		return false;
+	}
+	return GenerateSeats(Input, OutSeats);
+}
+
+void AASeatSpawnerBase::RegenerateSeats()
+{
+	// frozen seats come from baked data
+	if (!SeatManager || SeatManager->IsSeatLayoutFrozen()) return;
+
+	UpdateAndValidateSpline();
+
+	// a pending async scan must not land on top
+	++SeatGenerationSerial;
+
+	FSeatChunkLayout Seats;
+	GenerateSeatLayout(Seats);
+	SeatManager->RegisterSeatLayout(this, MoveTemp(Seats));
+}
+
+void AASeatSpawnerBase::GenerateSeatsAsync()
+{
+	if (!SeatManager || SeatManager->IsSeatLayoutFrozen()) return;
+
+	// anything still running for this spawner is stale from here on
+	const uint32 Serial = ++SeatGenerationSerial;
+
+	// spline read now, on the game thread. it may change again before the scan runs
+	FSeatGenerationInput Input;
+	if (!MakeSeatGenerationInput(Input))
+	{
+		SeatManager->RegisterSeatLayout(this, FSeatChunkLayout());
+		return;
+	}
+
+	TWeakObjectPtr<AASeatSpawnerBase> WeakThis(this);
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis, Serial, Input = MoveTemp(Input)]()
+	{
+		FSeatChunkLayout Seats;
+		GenerateSeats(Input, Seats);
+
+		// commit on the game thread, the manager and its HISMs live there
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Serial, Seats = MoveTemp(Seats)]() mutable
+		{
+			AASeatSpawnerBase* Spawner = WeakThis.Get();
+			// spawner gone, or spline edited again and a newer scan is on its way
+			if (!Spawner || Serial != Spawner->SeatGenerationSerial || !Spawner->SeatManager)
+			{
+				return;
+			}
+			Spawner->SeatManager->RegisterSeatLayout(Spawner, MoveTemp(Seats));
+		});
+	});
+}
+
+TArray<FTransform> AASeatSpawnerBase::GenerateTransforms()
+{
+	STANDS_SCOPE(STAT_Stands_GenerateTransforms);
+
+	// save the transforms
+	TArray<FTransform> GeneratedTransforms;
+
+	// BP registers these itself, so a pending async scan must not land on top
+	++SeatGenerationSerial;
+
+	FSeatChunkLayout Seats;
+	if (!GenerateSeatLayout(Seats))
+	{
+		return GeneratedTransforms; // return empty
 	}
 
+	// BP still gets full transforms
+	const FRotator BaseRotation = LocalForwardDirection.Rotation();
+	GeneratedTransforms.SetNumUninitialized(Seats.Num());
+	for (int32 i = 0; i < Seats.Num(); ++i)
+	{
+		GeneratedTransforms[i] = FTransform(BaseRotation, FVector(Seats.Positions[i]));
+	}
 	return GeneratedTransforms;
 }
 
@@ -5,10 +5,23 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/SplineComponent.h"
+#include "StandsSystem/SeatLayout.h"
 #include "ASeatSpawnerBase.generated.h"
 
 class AAGlobalSeatManager;
 
+// everything the seat scan needs, copied off the spawner so the scan can run on any thread
+struct FSeatGenerationInput
+{
+	// spline points, actor scale applied
+	TArray<FVector2D> Polygon;
+	FBox Bounds = FBox(ForceInit);
+	float RowSpacing = 1.0f;
+	float ColumnSpacing = 1.0f;
+	// FSeatLayout::QuantizeYaw
+	uint16 Yaw = 0;
+};
+
 UCLASS(meta = (PrioritizeCategories = "Parm"))
 class STADIUM56_API AASeatSpawnerBase : public AActor
 {
@@ -20,6 +33,19 @@ public:
 	
 	virtual void Destroyed() override;
 	FVector GetLocalForwardDirection() const { return LocalForwardDirection; }
+	float GetRowSpacing() const { return RowSpacing; }
+	float GetColumnSpacing() const { return ColumnSpacing; }
+
+	// native GenerateTransforms, straight into compact seats. false if the spline makes no seats
+	bool GenerateSeatLayout(FSeatChunkLayout& OutSeats) const;
+
+	// the seat scan itself, any thread
+	static bool GenerateSeats(const FSeatGenerationInput& Input, FSeatChunkLayout& OutSeats);
+
+	// native construction: validate spline, scan, move the seats into SeatManager.
+	// no construction script rerun, no TArray<FTransform> through the BP VM
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void RegenerateSeats();
 
 protected:
 	// Called when the game starts or when spawned
@@ -55,6 +81,11 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Parm")
 	TArray<FTransform> GenerateTransforms();
 
+	// GenerateTransforms + RegisterSeatChunk with the scan on a worker thread.
+	// seats reach SeatManager a frame or so later, results of older calls are dropped
+	UFUNCTION(BlueprintCallable, Category = "Parm")
+	void GenerateSeatsAsync();
+
 public:	
 
 	// spawner manager
@@ -64,4 +95,11 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+private:
+	// copy spline and spacing, game thread
+	bool MakeSeatGenerationInput(FSeatGenerationInput& OutInput) const;
+
+	// bumped by every generation. an async result with an older serial is stale
+	uint32 SeatGenerationSerial = 0;
+
 };
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/MemStack.h"
+#include "StandsSystem/CrowdWeights.h"
+#include "StandsSystem/SeatLayout.h"
+#include <atomic>
+
+class AACrowdVolume;
+
+// crowd bake data of AAGlobalCrowdManager. plain structs, any thread once built
+
+// volume boxes bucketed on a uniform XY grid, built once per bake.
+// each cell lists volume indices in ascending order, so the first hit is the old first-match-wins volume
+struct FCrowdVolumeGrid
+{
+	void Build(const TArray<FBox>& InBoxes)
+	{
+		Boxes = InBoxes;
+		Bounds = FBox(ForceInit);
+		for (const FBox& Box : Boxes)
+		{
+			if (Box.IsValid) Bounds += Box;
+		}
+
+		NumCellsX = NumCellsY = 0;
+		CellStart.Reset();
+		CellItems.Reset();
+		if (!Bounds.IsValid) return;
+
+		// ~4 cells per volume
+		const int32 CellsPerAxis = FMath::Clamp(FMath::CeilToInt(2.0f * FMath::Sqrt(static_cast<float>(Boxes.Num()))), 1, 128);
+		NumCellsX = NumCellsY = CellsPerAxis;
+		const FVector Size = Bounds.GetSize();
+		InvCellSizeX = NumCellsX / FMath::Max(Size.X, 1.0);
+		InvCellSizeY = NumCellsY / FMath::Max(Size.Y, 1.0);
+
+		// count, prefix sum, fill
+		CellStart.SetNumZeroed(NumCellsX * NumCellsY + 1);
+		ForEachCell([this](int32 Cell, int32 BoxIdx) { ++CellStart[Cell + 1]; });
+		for (int32 Cell = 0; Cell < NumCellsX * NumCellsY; ++Cell)
+		{
+			CellStart[Cell + 1] += CellStart[Cell];
+		}
+
+		CellItems.SetNumUninitialized(CellStart.Last());
+		TArray<int32> Cursor(CellStart.GetData(), NumCellsX * NumCellsY);
+		ForEachCell([this, &Cursor](int32 Cell, int32 BoxIdx) { CellItems[Cursor[Cell]++] = BoxIdx; });
+	}
+
+	// INDEX_NONE if no box holds the point
+	int32 FindFirstContaining(const FVector& Point) const
+	{
+		// nothing can be strictly inside a box and outside the union
+		if (NumCellsX == 0 || !Bounds.IsInside(Point)) return INDEX_NONE;
+
+		const int32 Cell = CellY(Point.Y) * NumCellsX + CellX(Point.X);
+		for (int32 k = CellStart[Cell]; k < CellStart[Cell + 1]; ++k)
+		{
+			const int32 BoxIdx = CellItems[k];
+			if (Boxes[BoxIdx].IsInside(Point)) return BoxIdx;
+		}
+		return INDEX_NONE;
+	}
+
+	// sets the bit of every box touching Query. InOutHits is sized to the box count
+	void FindOverlapping(const FBox& Query, TBitArray<>& InOutHits) const
+	{
+		InOutHits.SetNum(Boxes.Num(), false);
+		if (NumCellsX == 0 || !Query.IsValid || !Bounds.Intersect(Query)) return;
+
+		const int32 X0 = CellX(Query.Min.X), X1 = CellX(Query.Max.X);
+		const int32 Y0 = CellY(Query.Min.Y), Y1 = CellY(Query.Max.Y);
+		for (int32 Y = Y0; Y <= Y1; ++Y)
+		{
+			for (int32 X = X0; X <= X1; ++X)
+			{
+				const int32 Cell = Y * NumCellsX + X;
+				for (int32 k = CellStart[Cell]; k < CellStart[Cell + 1]; ++k)
+				{
+					const int32 BoxIdx = CellItems[k];
+					if (!InOutHits[BoxIdx] && Boxes[BoxIdx].Intersect(Query))
+					{
+						InOutHits[BoxIdx] = true;
+					}
+				}
+			}
+		}
+	}
+
+private:
+	int32 CellX(double X) const { return FMath::Clamp(FMath::FloorToInt32((X - Bounds.Min.X) * InvCellSizeX), 0, NumCellsX - 1); }
+	int32 CellY(double Y) const { return FMath::Clamp(FMath::FloorToInt32((Y - Bounds.Min.Y) * InvCellSizeY), 0, NumCellsY - 1); }
+
+	// boxes in ascending index order
+	template <typename FuncType>
+	void ForEachCell(FuncType&& Func) const
+	{
+		for (int32 BoxIdx = 0; BoxIdx < Boxes.Num(); ++BoxIdx)
+		{
+			const FBox& Box = Boxes[BoxIdx];
+			if (!Box.IsValid) continue;
+
+			const int32 X0 = CellX(Box.Min.X), X1 = CellX(Box.Max.X);
+			const int32 Y0 = CellY(Box.Min.Y), Y1 = CellY(Box.Max.Y);
+			for (int32 Y = Y0; Y <= Y1; ++Y)
+			{
+				for (int32 X = X0; X <= X1; ++X)
+				{
+					Func(Y * NumCellsX + X, BoxIdx);
+				}
+			}
+		}
+	}
+
+	TArray<FBox> Boxes;
+	FBox Bounds = FBox(ForceInit);
+	int32 NumCellsX = 0;
+	int32 NumCellsY = 0;
+	double InvCellSizeX = 0.0;
+	double InvCellSizeY = 0.0;
+
+	// cell c owns CellItems[CellStart[c] .. CellStart[c + 1])
+	TArray<int32> CellStart;
+	TArray<int32> CellItems;
+};
+
+// per bake lookups, shared by full and delta bakes
+struct FCrowdBakeContext
+{
+	// seat snapshot for the whole bake, never null
+	TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> Seats;
+
+	// iterator order = priority
+	TArray<const AACrowdVolume*> Volumes;
+	TArray<FBox> VolumeBoxes;
+	FCrowdVolumeGrid VolumeGrid;
+	// copied off the volumes, workers never touch the actors
+	TArray<int32> VolumeSeeds;
+	TArray<float> VolumeDensities;
+
+	// [0] is the manager's profile, VolumeWeightTable maps volume -> table
+	TArray<FCrowdAliasTable> WeightTables;
+	TArray<int32> VolumeWeightTable;
+
+	int32 NumMeshes = 0;
+	int32 NumMats = 0;
+	int32 NumHISMs = 0;
+
+	// one HISM per mesh, clip index goes to custom data
+	bool bClipInCustomData = false;
+
+	int32 RandomSeed = 0;
+	FTransform InstanceOffset;
+};
+
+// one bake: its context, the worker's picks, and how far the game thread got adding them
+struct FCrowdBakePlan
+{
+	FCrowdBakeContext Context;
+
+	// per HISM, filled by BuildBakePlan
+	TArray<TArray<FTransform>> HismTransforms;
+	TArray<TArray<float>> HismCustomData;
+	TArray<TArray<int32>> HismSeats;
+	int32 NumInstances = 0;
+
+	// worker <-> game thread
+	std::atomic<bool> bCancelled{ false };
+	std::atomic<bool> bPlanReady{ false };
+	std::atomic<int32> NumSeatsScanned{ 0 };
+
+	// game thread add cursor
+	int32 ApplyHism = 0;
+	int32 ApplyInstance = 0;
+	int32 NumApplied = 0;
+
+	// one batch of a time sliced HISM, reused by every batch
+	TArray<FTransform> SliceTransforms;
+	TArray<float> SliceCustomData;
+
+	uint32 Serial = 0;
+	double StartTime = 0.0;
+
+	// filter is the first half, adding instances the second
+	float GetProgress() const
+	{
+		if (!bPlanReady)
+		{
+			const int32 NumSeats = Context.Seats.IsValid() ? Context.Seats->Num() : 0;
+			return NumSeats > 0 ? 0.5f * FMath::Min(static_cast<float>(NumSeatsScanned.load()) / NumSeats, 1.0f) : 0.0f;
+		}
+		return 0.5f + (NumInstances > 0 ? 0.5f * NumApplied / NumInstances : 0.5f);
+	}
+};
+
+// pass 1 of BuildBakePlan, per seat. scratch on the mem stack of the thread building the plan,
+// gone with its FMemMark
+struct FCrowdSeatPicks
+{
+	// INDEX_NONE = empty seat
+	TArray<int32, TMemStackAllocator<>> Hism;
+	TArray<float, TMemStackAllocator<>> TimeOffset;
+	TArray<int32, TMemStackAllocator<>> Clip;
+
+	// instances per HISM
+	TArray<int32, TMemStackAllocator<>> HismCounts;
+};
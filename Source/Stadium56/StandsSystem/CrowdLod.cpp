@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/CrowdLod.h"
+
+// off screen still counts a little: shadows, and the camera turns
+static constexpr float OffScreenSignificance = 0.25f;
+
+float CrowdLod::GetSignificance(const FCrowdLodSection& Section, const FCrowdLodView& View)
+{
+	if (!Section.Bounds.IsValid) return 0.0f;
+
+	const FVector ToSection = Section.Bounds.GetCenter() - View.Location;
+	const double Radius = Section.Bounds.GetExtent().Size();
+	const double Distance = ToSection.Size();
+
+	// 1 = as wide as the view
+	const double ScreenSize = Radius / FMath::Max(Distance * FMath::Tan(View.HalfFov), 1.0);
+
+	// bounding sphere against the view cone
+	const double ConeAngle = View.HalfFov + FMath::Atan2(Radius, Distance);
+	const bool bInView = Distance <= Radius || ConeAngle >= UE_PI
+		|| FVector::DotProduct(ToSection / Distance, View.Forward) >= FMath::Cos(ConeAngle);
+
+	return static_cast<float>(ScreenSize) * (bInView ? 1.0f : OffScreenSignificance);
+}
+
+void CrowdLod::AssignTiers(TArray<FCrowdLodSection>& Sections, const FCrowdLodView& View, const FCrowdLodSettings& Settings)
+{
+	TArray<int32, TInlineAllocator<256>> Order;
+	Order.SetNumUninitialized(Sections.Num());
+	for (int32 i = 0; i < Sections.Num(); ++i)
+	{
+		Sections[i].Significance = GetSignificance(Sections[i], View);
+		Order[i] = i;
+	}
+
+	// ties by index, same camera = same tiers
+	Order.Sort([&Sections](int32 A, int32 B)
+	{
+		return Sections[A].Significance != Sections[B].Significance ? Sections[A].Significance > Sections[B].Significance : A < B;
+	});
+
+	const double Slack = 1.0 + Settings.Hysteresis;
+	int32 NumFull = 0;
+	int32 NumFrozen = 0;
+	for (const int32 SectionIdx : Order)
+	{
+		FCrowdLodSection& Section = Sections[SectionIdx];
+		const double Distance = Section.Bounds.IsValid ? FMath::Sqrt(Section.Bounds.ComputeSquaredDistanceToPoint(View.Location)) : DBL_MAX;
+
+		// already in a tier -> it holds a little past its distance
+		ECrowdLodTier Tier = ECrowdLodTier::Far;
+		if (Distance <= Settings.FullDistance * (Section.Tier == ECrowdLodTier::Full ? Slack : 1.0))
+		{
+			Tier = ECrowdLodTier::Full;
+		}
+		else if (Distance <= Settings.FarDistance * (Section.Tier != ECrowdLodTier::Far ? Slack : 1.0))
+		{
+			Tier = ECrowdLodTier::Frozen;
+		}
+
+		if (Tier == ECrowdLodTier::Full && NumFull + Section.NumMembers > Settings.MaxFullInstances)
+		{
+			Tier = ECrowdLodTier::Frozen;
+		}
+		if (Tier == ECrowdLodTier::Frozen && NumFrozen + Section.NumMembers > Settings.MaxFrozenInstances)
+		{
+			Tier = ECrowdLodTier::Far;
+		}
+		NumFull += Tier == ECrowdLodTier::Full ? Section.NumMembers : 0;
+		NumFrozen += Tier == ECrowdLodTier::Frozen ? Section.NumMembers : 0;
+
+		if (Tier != Section.Tier)
+		{
+			Section.Tier = Tier;
+			Section.bSettled = false;
+			Section.MoveCursor = 0;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CrowdLod.generated.h"
+
+// where a crowd member is drawn, AAGlobalCrowdManager LOD
+UENUM(BlueprintType)
+enum class ECrowdLodTier : uint8
+{
+	// the baked crowd HISMs, VAT material
+	Full,
+	// pooled frozen pose mesh, no world position offset
+	Frozen,
+	// frozen pose, thinned (LodFarKeepFraction) and no shadows, the rest culled
+	Far,
+};
+
+// tier limits, from the crowd manager's LOD properties
+struct FCrowdLodSettings
+{
+	// section bounds closer than this may be Full, then Frozen up to FarDistance
+	double FullDistance = 5000.0;
+	double FarDistance = 15000.0;
+	// a section keeps its tier until this fraction past the distance, no flicker on the edge
+	double Hysteresis = 0.1;
+	// most significant sections first, the rest drop a tier
+	int32 MaxFullInstances = 20000;
+	int32 MaxFrozenInstances = 60000;
+};
+
+// the active camera
+struct FCrowdLodView
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Forward = FVector::ForwardVector;
+	// radians
+	double HalfFov = UE_HALF_PI * 0.5;
+};
+
+// one seat spawner's seats, they change tier together
+struct FCrowdLodSection
+{
+	// seats [FirstSeat, FirstSeat + NumSeats) of the LOD snapshot
+	int32 FirstSeat = 0;
+	int32 NumSeats = 0;
+	// seats with a crowd member
+	int32 NumMembers = 0;
+	FBox Bounds = FBox(ForceInit);
+
+	// target. the members get there in time sliced batches
+	ECrowdLodTier Tier = ECrowdLodTier::Full;
+	// every member is in Tier
+	bool bSettled = true;
+	// seats before it are in Tier
+	int32 MoveCursor = 0;
+
+	// projected size, lowered off screen. higher keeps Full first and moves first
+	float Significance = 0.0f;
+};
+
+namespace CrowdLod
+{
+	STADIUM56_API float GetSignificance(const FCrowdLodSection& Section, const FCrowdLodView& View);
+
+	// Significance and Tier of every section: distance caps the tier, the budgets go by significance.
+	// a section whose tier changed is unsettled from its first seat again
+	STADIUM56_API void AssignTiers(TArray<FCrowdLodSection>& Sections, const FCrowdLodView& View, const FCrowdLodSettings& Settings);
+}
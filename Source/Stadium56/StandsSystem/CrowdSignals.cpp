@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/CrowdSignals.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+
+const FName CrowdSignals::WaveOrigin(TEXT("CrowdWaveOrigin"));
+const FName CrowdSignals::WaveParams(TEXT("CrowdWaveParams"));
+const FName CrowdSignals::WaveStartAngle(TEXT("CrowdWaveStartAngle"));
+const FName CrowdSignals::Excitement(TEXT("CrowdExcitement"));
+const FName CrowdSignals::GazeTarget(TEXT("CrowdGazeTarget"));
+
+// a wave stands up and sits down over this long at both ends
+static constexpr double WaveFadeSeconds = 1.0;
+
+TArray<FName> CrowdSignals::GetMissingParameters(const UMaterialParameterCollection* Collection)
+{
+	TArray<FName> Missing;
+	if (!Collection) return Missing;
+
+	for (const FName& Name : { WaveStartAngle, Excitement })
+	{
+		if (!Collection->GetScalarParameterByName(Name)) Missing.Add(Name);
+	}
+	for (const FName& Name : { WaveOrigin, WaveParams, GazeTarget })
+	{
+		if (!Collection->GetVectorParameterByName(Name)) Missing.Add(Name);
+	}
+	return Missing;
+}
+
+float FCrowdSignalBlend::GetAlpha(double Now) const
+{
+	if (Seconds <= 0.0) return 1.0f;
+	return FMath::SmoothStep(0.0f, 1.0f, static_cast<float>((Now - StartTime) / Seconds));
+}
+
+float FCrowdSignalState::GetExcitement(double Now) const
+{
+	return FMath::Lerp(ExcitementFrom, ExcitementTo, ExcitementBlend.GetAlpha(Now));
+}
+
+FVector FCrowdSignalState::GetGazeTarget(double Now) const
+{
+	return FMath::Lerp(GazeFrom, GazeTo, static_cast<double>(GazeBlend.GetAlpha(Now)));
+}
+
+float FCrowdSignalState::GetGazeWeight(double Now) const
+{
+	return FMath::Lerp(GazeWeightFrom, GazeWeightTo, GazeBlend.GetAlpha(Now));
+}
+
+float FCrowdSignalState::GetWaveFade(double Now) const
+{
+	const double Time = Now - WaveStartTime;
+	if (WaveSeconds <= 0.0 || Time < 0.0 || Time >= WaveSeconds) return 0.0f;
+	return static_cast<float>(FMath::Clamp(FMath::Min(Time, WaveSeconds - Time) / WaveFadeSeconds, 0.0, 1.0));
+}
+
+void FCrowdSignalState::SetExcitement(float Level, double Now, double Seconds)
+{
+	// from wherever it is now, no jump mid blend
+	ExcitementFrom = GetExcitement(Now);
+	ExcitementTo = FMath::Clamp(Level, 0.0f, 1.0f);
+	ExcitementBlend.StartTime = Now;
+	ExcitementBlend.Seconds = FMath::Max(Seconds, 0.0);
+}
+
+void FCrowdSignalState::SetGaze(const FVector& Target, float Weight, double Now, double Seconds)
+{
+	// nobody looked anywhere yet: start at the new target, only the weight blends
+	GazeFrom = GetGazeWeight(Now) > 0.0f ? GetGazeTarget(Now) : Target;
+	GazeWeightFrom = GetGazeWeight(Now);
+	GazeTo = Target;
+	GazeWeightTo = FMath::Clamp(Weight, 0.0f, 1.0f);
+	GazeBlend.StartTime = Now;
+	GazeBlend.Seconds = FMath::Max(Seconds, 0.0);
+}
+
+bool FCrowdSignalState::IsActive(double Now) const
+{
+	return Now < WaveStartTime + WaveSeconds || !ExcitementBlend.IsDone(Now) || !GazeBlend.IsDone(Now);
+}
+
+void FCrowdSignalState::Write(UMaterialParameterCollectionInstance* Collection, double Now) const
+{
+	if (!Collection) return;
+
+	const float WaveTime = static_cast<float>(FMath::Max(Now - WaveStartTime, 0.0));
+	const FVector Gaze = GetGazeTarget(Now);
+	Collection->SetVectorParameterValue(CrowdSignals::WaveOrigin, FLinearColor(WaveOrigin.X, WaveOrigin.Y, WaveOrigin.Z, static_cast<float>(WaveShape)));
+	Collection->SetVectorParameterValue(CrowdSignals::WaveParams, FLinearColor(WaveTime, WaveSpeed, FMath::Max(WaveWidth, 1.0f), GetWaveFade(Now)));
+	Collection->SetScalarParameterValue(CrowdSignals::WaveStartAngle, WaveStartAngle);
+	Collection->SetScalarParameterValue(CrowdSignals::Excitement, GetExcitement(Now));
+	Collection->SetVectorParameterValue(CrowdSignals::GazeTarget, FLinearColor(Gaze.X, Gaze.Y, Gaze.Z, GetGazeWeight(Now)));
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CrowdSignals.generated.h"
+
+class UMaterialParameterCollection;
+class UMaterialParameterCollectionInstance;
+
+UENUM(BlueprintType)
+enum class ECrowdWaveShape : uint8
+{
+	// ring out from the origin, goal celebrations
+	Ripple,
+	// once around the bowl, starting on the origin's side. Mexican wave
+	AroundBowl,
+};
+
+// stadium wide crowd reactions as a few material parameter collection values, no per instance writes.
+// the VAT materials read them with the instance position (ObjectPosition on a HISM) P:
+//   wave    Ripple:     d = distance(P.xy, CrowdWaveOrigin.xy)                    front = t * speed  (cm)
+//           AroundBowl: d = fmod(atan2 of P - CrowdWaveOrigin in degrees - CrowdWaveStartAngle + 720, 360)
+//                                                                                front = t * speed  (degrees)
+//           lift = saturate(1 - abs(d - front) / width) * fade, CrowdWaveParams = (t, speed, width, fade)
+//   excitement  CrowdExcitement 0..1, scales the clip or blends to a cheer clip
+//   gaze        lerp(clip facing, normalize(CrowdGazeTarget.xyz - P), CrowdGazeTarget.w)
+// the LOD Frozen and Far tiers have no world position offset and ignore them
+namespace CrowdSignals
+{
+	// vector: xyz origin (Ripple) or bowl center (AroundBowl), w shape as float
+	STADIUM56_API extern const FName WaveOrigin;
+	// vector: x seconds since the trigger, y speed, z width, w fade in/out 0..1. 0 fade = no wave
+	STADIUM56_API extern const FName WaveParams;
+	// scalar: AroundBowl start, degrees around the bowl center from +X
+	STADIUM56_API extern const FName WaveStartAngle;
+	// scalar 0..1
+	STADIUM56_API extern const FName Excitement;
+	// vector: xyz world target, w weight 0..1
+	STADIUM56_API extern const FName GazeTarget;
+
+	// names above the collection lacks, for a warning
+	STADIUM56_API TArray<FName> GetMissingParameters(const UMaterialParameterCollection* Collection);
+}
+
+// eases from the value it had when set to the new target
+struct FCrowdSignalBlend
+{
+	double StartTime = 0.0;
+	double Seconds = 0.0;
+
+	// 0..1 smoothstep, 1 once done
+	float GetAlpha(double Now) const;
+	bool IsDone(double Now) const { return Now >= StartTime + Seconds; }
+};
+
+// everything the collection holds. game world seconds
+struct STADIUM56_API FCrowdSignalState
+{
+	// wave
+	FVector WaveOrigin = FVector::ZeroVector;
+	ECrowdWaveShape WaveShape = ECrowdWaveShape::Ripple;
+	float WaveStartAngle = 0.0f;
+	float WaveSpeed = 0.0f;
+	float WaveWidth = 1.0f;
+	double WaveStartTime = 0.0;
+	// 0 = no wave
+	double WaveSeconds = 0.0;
+
+	float ExcitementFrom = 0.0f;
+	float ExcitementTo = 0.0f;
+	FCrowdSignalBlend ExcitementBlend;
+
+	FVector GazeFrom = FVector::ZeroVector;
+	FVector GazeTo = FVector::ZeroVector;
+	float GazeWeightFrom = 0.0f;
+	float GazeWeightTo = 0.0f;
+	FCrowdSignalBlend GazeBlend;
+
+	float GetExcitement(double Now) const;
+	FVector GetGazeTarget(double Now) const;
+	float GetGazeWeight(double Now) const;
+	float GetWaveFade(double Now) const;
+
+	void SetExcitement(float Level, double Now, double Seconds);
+	void SetGaze(const FVector& Target, float Weight, double Now, double Seconds);
+
+	// a wave runs or a blend is under way, the values change every frame
+	bool IsActive(double Now) const;
+
+	// the collection's values at Now, five writes whatever the crowd size
+	void Write(UMaterialParameterCollectionInstance* Collection, double Now) const;
+};
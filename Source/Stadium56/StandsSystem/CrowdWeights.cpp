@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/CrowdWeights.h"
+#include "StandsSystem/StandsRandom.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+
+void FCrowdAliasTable::Build(const TArray<float>& Weights)
+{
+	const int32 NumColumns = Weights.Num();
+	Probability.SetNumUninitialized(NumColumns);
+	Alias.SetNumUninitialized(NumColumns);
+	if (NumColumns == 0) return;
+
+	double Sum = 0.0;
+	for (const float Weight : Weights)
+	{
+		Sum += FMath::Max(Weight, 0.0f);
+	}
+
+	// scale so the mean column is 1
+	TArray<double> Scaled;
+	Scaled.SetNumUninitialized(NumColumns);
+	for (int32 i = 0; i < NumColumns; ++i)
+	{
+		Scaled[i] = Sum > 0.0 ? FMath::Max(Weights[i], 0.0f) * NumColumns / Sum : 1.0;
+	}
+
+	TArray<int32> Small;
+	TArray<int32> Large;
+	for (int32 i = 0; i < NumColumns; ++i)
+	{
+		(Scaled[i] < 1.0 ? Small : Large).Add(i);
+	}
+
+	// vose: top up each small column from a large one
+	while (Small.Num() > 0 && Large.Num() > 0)
+	{
+		const int32 Less = Small.Pop(EAllowShrinking::No);
+		const int32 More = Large.Pop(EAllowShrinking::No);
+
+		Probability[Less] = static_cast<float>(Scaled[Less]);
+		Alias[Less] = More;
+
+		Scaled[More] = (Scaled[More] + Scaled[Less]) - 1.0;
+		(Scaled[More] < 1.0 ? Small : Large).Add(More);
+	}
+
+	// leftovers are full columns, Small only from rounding
+	for (const int32 i : Large)
+	{
+		Probability[i] = 1.0f;
+		Alias[i] = i;
+	}
+	for (const int32 i : Small)
+	{
+		Probability[i] = 1.0f;
+		Alias[i] = i;
+	}
+}
+
+void FCrowdAliasTable::Build(const FMaterialWeights& Weights, int32 NumOptions)
+{
+	TArray<float> ProfileWeights;
+	ProfileWeights.SetNumUninitialized(FMath::Max(NumOptions, 0));
+	for (int32 i = 0; i < ProfileWeights.Num(); ++i)
+	{
+		ProfileWeights[i] = Weights.GetWeightByIndex(i);
+	}
+	Build(ProfileWeights);
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrowdAliasTableTest, "Stands.Crowd.AliasTable",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+// picks from several weight profiles vs their target distribution. zero weight clips never come up
+bool FCrowdAliasTableTest::RunTest(const FString& Parameters)
+{
+	const int32 NumSamples = 1000000;
+	const int32 Seed = 777;
+
+	TArray<TArray<float>> Profiles;
+	Profiles.Add({ 100.f, 100.f, 100.f, 100.f, 100.f, 100.f });
+	Profiles.Add({ 5.f, 0.f, 1.f, 10.f, 0.f, 3.f });
+	Profiles.Add({ 1.f });
+	Profiles.Add({ 0.f, 0.f, 0.f, 0.f });
+	Profiles.Add({ 1000.f, 1.f, 1.f });
+	Profiles.Add({ 2.f, -4.f, 1.f });
+	// many clips
+	TArray<float>& ManyClips = Profiles.AddDefaulted_GetRef();
+	for (int32 i = 0; i < 37; ++i)
+	{
+		ManyClips.Add(FStandsRandom::Fraction(Seed, i, EStandsRandomStream::Density) * 50.f);
+	}
+	// a volume profile, past its weights the clips get 0
+	FMaterialWeights VolumeWeights;
+	VolumeWeights.Clap = 0.f;
+	VolumeWeights.AdditionalWeights = { 250.f, 7.f };
+	TArray<float>& VolumeProfile = Profiles.AddDefaulted_GetRef();
+	for (int32 i = 0; i < VolumeWeights.GetNumWeights() + 2; ++i)
+	{
+		VolumeProfile.Add(VolumeWeights.GetWeightByIndex(i));
+	}
+
+	for (int32 ProfileIdx = 0; ProfileIdx < Profiles.Num(); ++ProfileIdx)
+	{
+		const TArray<float>& Weights = Profiles[ProfileIdx];
+		const int32 NumClips = Weights.Num();
+
+		FCrowdAliasTable Table;
+		if (ProfileIdx == Profiles.Num() - 1)
+		{
+			Table.Build(VolumeWeights, NumClips);
+		}
+		else
+		{
+			Table.Build(Weights);
+		}
+		if (!TestEqual(FString::Printf(TEXT("profile %d columns"), ProfileIdx), Table.Num(), NumClips)) continue;
+
+		TArray<int32> Counts;
+		Counts.SetNumZeroed(NumClips);
+		bool bInRange = true;
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			const int32 Clip = Table.Pick(FStandsRandom::Fraction(Seed, i, EStandsRandomStream::Material));
+			bInRange &= Counts.IsValidIndex(Clip);
+			if (Counts.IsValidIndex(Clip)) ++Counts[Clip];
+		}
+		TestTrue(FString::Printf(TEXT("profile %d picks in range"), ProfileIdx), bInRange);
+
+		double Sum = 0.0;
+		for (const float Weight : Weights)
+		{
+			Sum += FMath::Max(Weight, 0.0f);
+		}
+
+		// chi-square over clips with weight
+		double Chi2 = 0.0;
+		int32 DegreesOfFreedom = -1;
+		for (int32 Clip = 0; Clip < NumClips; ++Clip)
+		{
+			const double Target = Sum > 0.0 ? FMath::Max(Weights[Clip], 0.0f) / Sum : 1.0 / NumClips;
+			if (Target <= 0.0)
+			{
+				TestEqual(FString::Printf(TEXT("profile %d zero weight clip %d never picked"), ProfileIdx, Clip), Counts[Clip], 0);
+				continue;
+			}
+			const double Expected = Target * NumSamples;
+			Chi2 += FMath::Square(Counts[Clip] - Expected) / Expected;
+			++DegreesOfFreedom;
+		}
+
+		// normal approximation, ~5 sigma
+		const double Chi2Limit = DegreesOfFreedom > 0 ? DegreesOfFreedom + 5.0 * FMath::Sqrt(2.0 * DegreesOfFreedom) : 1e-9;
+		if (Chi2 > Chi2Limit)
+		{
+			AddError(FString::Printf(TEXT("profile %d, %d clips: chi2 %.2f over %.2f"), ProfileIdx, NumClips, Chi2, Chi2Limit));
+		}
+	}
+
+	// an empty table picks nothing
+	FCrowdAliasTable Empty;
+	Empty.Build(TArray<float>());
+	TestEqual(TEXT("empty table"), Empty.Pick(0.5f), static_cast<int32>(INDEX_NONE));
+	return true;
+}
+#endif
+
+#if !UE_BUILD_SHIPPING
+
+// Stands.BenchAliasTable [Samples]
+// alias pick vs the old re-sum and linear scan, on a many clip profile
+static void BenchAliasTable(const TArray<FString>& Args)
+{
+	const int32 NumSamples = Args.Num() > 0 ? FMath::Max(1000, FCString::Atoi(*Args[0])) : 1000000;
+	const int32 Seed = 777;
+
+	TArray<float> ManyClips;
+	for (int32 i = 0; i < 37; ++i)
+	{
+		ManyClips.Add(FStandsRandom::Fraction(Seed, i, EStandsRandomStream::Density) * 50.f);
+	}
+
+	FCrowdAliasTable Table;
+	Table.Build(ManyClips);
+
+	int32 AliasSink = 0;
+	const double AliasStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		AliasSink += Table.Pick(FStandsRandom::Fraction(Seed, i, EStandsRandomStream::Material));
+	}
+	const double AliasMs = (FPlatformTime::Seconds() - AliasStart) * 1000.0;
+
+	// the old PickMIByWeight: re-sum then scan
+	int32 LinearSink = 0;
+	const double LinearStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		float Sum = 0.0f;
+		for (const float Weight : ManyClips) Sum += Weight;
+
+		const float Roll = FStandsRandom::Fraction(Seed, i, EStandsRandomStream::Material) * Sum;
+		float CurrentWeightSum = 0.0f;
+		int32 Picked = ManyClips.Num() - 1;
+		for (int32 Clip = 0; Clip < ManyClips.Num(); ++Clip)
+		{
+			CurrentWeightSum += ManyClips[Clip];
+			if (Roll < CurrentWeightSum)
+			{
+				Picked = Clip;
+				break;
+			}
+		}
+		LinearSink += Picked;
+	}
+	const double LinearMs = (FPlatformTime::Seconds() - LinearStart) * 1000.0;
+
+	UE_LOG(LogTemp, Log, TEXT("BenchAliasTable %d picks over %d clips: alias %.2f ms, linear %.2f ms (%d %d)"),
+		NumSamples, ManyClips.Num(), AliasMs, LinearMs, AliasSink, LinearSink);
+}
+
+static FAutoConsoleCommand BenchAliasTableCmd(
+	TEXT("Stands.BenchAliasTable"),
+	TEXT("Time crowd alias table picks against the old linear scan. Arg: sample count (default 1000000)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchAliasTable));
+
+#endif
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CrowdWeights.generated.h"
+
+USTRUCT(BlueprintType)
+struct FMaterialWeights
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	float WaveHand;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	float ClapHigh;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	float Clap;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	float Upset;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	float Idle;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	float Yell;
+
+	// clips after Yell, in VATMats order
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weights", meta = (ClampMin = "0.0"))
+	TArray<float> AdditionalWeights;
+
+	FMaterialWeights()
+	{
+		WaveHand = 100.f;
+		ClapHigh = 100.f;
+		Clap = 100.f;
+		Upset = 100.f;
+		Idle = 100.f;
+		Yell = 100.f;
+	}
+
+	float GetWeightByIndex(int32 Index) const
+	{
+		switch (Index)
+		{
+			case 0: return WaveHand;
+			case 1: return ClapHigh;
+			case 2: return Clap;
+			case 3: return Upset;
+			case 4: return Idle;
+			case 5: return Yell;
+			default: return AdditionalWeights.IsValidIndex(Index - 6) ? AdditionalWeights[Index - 6] : 0.0f;
+		}
+	}
+
+	int32 GetNumWeights() const { return 6 + AdditionalWeights.Num(); }
+};
+
+// walker/vose alias table. built once per bake, O(1) weighted pick for any number of clips
+struct STADIUM56_API FCrowdAliasTable
+{
+	// negative weights count as 0. all zero -> uniform
+	void Build(const TArray<float>& Weights);
+
+	// first NumOptions weights of a profile
+	void Build(const FMaterialWeights& Weights, int32 NumOptions);
+
+	// Roll in [0, 1). INDEX_NONE if empty
+	FORCEINLINE int32 Pick(float Roll) const
+	{
+		const int32 NumColumns = Probability.Num();
+		if (NumColumns == 0) return INDEX_NONE;
+
+		// one roll picks the column, what is left of it flips the coin
+		const float Scaled = Roll * NumColumns;
+		const int32 Column = FMath::Min(static_cast<int32>(Scaled), NumColumns - 1);
+		return (Scaled - Column) < Probability[Column] ? Column : Alias[Column];
+	}
+
+	int32 Num() const { return Probability.Num(); }
+
+private:
+	// chance to keep the column, else take Alias
+	TArray<float> Probability;
+	TArray<int32> Alias;
+};
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include "SeatLayout.generated.h"
+
+// seats of one spawner, structure of arrays. ~20 bytes a seat instead of a 96 byte FTransform
+// positions are spawner local with the actor scale already applied
+USTRUCT()
+struct FSeatChunkLayout
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FVector3f> Positions;
+
+	// FSeatLayout::QuantizeYaw
+	UPROPERTY()
+	TArray<uint16> Yaws;
+
+	UPROPERTY()
+	TArray<int16> Rows;
+
+	UPROPERTY()
+	TArray<int16> Columns;
+
+	int32 Num() const { return Positions.Num(); }
+
+	void Reset()
+	{
+		Positions.Reset();
+		Yaws.Reset();
+		Rows.Reset();
+		Columns.Reset();
+	}
+
+	// all four arrays, contents undefined
+	void SetNumUninitialized(int32 NumSeats)
+	{
+		Positions.SetNumUninitialized(NumSeats);
+		Yaws.SetNumUninitialized(NumSeats);
+		Rows.SetNumUninitialized(NumSeats);
+		Columns.SetNumUninitialized(NumSeats);
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Positions.GetAllocatedSize() + Yaws.GetAllocatedSize() + Rows.GetAllocatedSize() + Columns.GetAllocatedSize();
+	}
+};
+
+// every registered seat, flat. canonical seat storage of AAGlobalSeatManager.
+// FTransforms only get built when instances go to a HISM
+// published as an immutable FSeatLayoutRef, so any thread may read a snapshot it holds
+struct FSeatLayout
+{
+	// NextVersion() of every rebuild, 0 = nothing built yet.
+	// unique over all managers, so a cache keyed on it never mistakes one manager's seats for another's
+	uint32 Version = 0;
+
+	// process wide, monotonic, never 0
+	static uint32 NextVersion()
+	{
+		static std::atomic<uint32> LastVersion{ 0 };
+		return ++LastVersion;
+	}
+
+	// per seat
+	TArray<FVector3f> Positions;
+	TArray<uint16> Yaws;
+	TArray<uint16> SpawnerIds;
+	TArray<int16> Rows;
+	TArray<int16> Columns;
+
+	// per spawner id: spawner world transform, scale 1
+	TArray<FTransform> SpawnerTransforms;
+
+	// seat vs cone offsets, same for every seat
+	FRotator SeatRotation = FRotator::ZeroRotator;
+	FVector SeatScale = FVector::OneVector;
+
+	int32 Num() const { return Positions.Num(); }
+
+	void Reset()
+	{
+		Positions.Reset();
+		Yaws.Reset();
+		SpawnerIds.Reset();
+		Rows.Reset();
+		Columns.Reset();
+		SpawnerTransforms.Reset();
+	}
+
+	// append one spawner's seats
+	void AppendChunk(const FSeatChunkLayout& Chunk, const FTransform& SpawnerTransform)
+	{
+		const uint16 SpawnerId = static_cast<uint16>(SpawnerTransforms.Add(SpawnerTransform));
+		Positions.Append(Chunk.Positions);
+		Yaws.Append(Chunk.Yaws);
+		Rows.Append(Chunk.Rows);
+		Columns.Append(Chunk.Columns);
+
+		const int32 First = SpawnerIds.AddUninitialized(Chunk.Num());
+		for (int32 i = 0; i < Chunk.Num(); ++i)
+		{
+			SpawnerIds[First + i] = SpawnerId;
+		}
+	}
+
+	// world seat position, cheaper than GetTransform
+	FVector GetLocation(int32 SeatIdx) const
+	{
+		return SpawnerTransforms[SpawnerIds[SeatIdx]].TransformPosition(FVector(Positions[SeatIdx]));
+	}
+
+	FTransform GetTransform(int32 SeatIdx) const
+	{
+		return MakeTransform(Positions[SeatIdx], Yaws[SeatIdx], SpawnerTransforms[SpawnerIds[SeatIdx]], SeatRotation, SeatScale);
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Positions.GetAllocatedSize() + Yaws.GetAllocatedSize() + SpawnerIds.GetAllocatedSize()
+			+ Rows.GetAllocatedSize() + Columns.GetAllocatedSize() + SpawnerTransforms.GetAllocatedSize();
+	}
+
+	// the one place a seat becomes an FTransform
+	static FTransform MakeTransform(const FVector3f& Position, uint16 Yaw, const FTransform& SpawnerTransform, const FRotator& SeatRotation, const FVector& SeatScale)
+	{
+		const FTransform LocalTransform(FRotator(0.0f, DequantizeYaw(Yaw), 0.0f) + SeatRotation, FVector(Position), SeatScale);
+		return LocalTransform * SpawnerTransform;
+	}
+
+	// row or column index of a seat, saturated to int16 so a huge spawner never wraps. every path stores it through here
+	static int16 ClampRowColumn(int32 Index)
+	{
+		return static_cast<int16>(FMath::Clamp(Index, static_cast<int32>(MIN_int16), static_cast<int32>(MAX_int16)));
+	}
+
+	// 65536 steps a turn, 90 degree steps are exact
+	static uint16 QuantizeYaw(double Yaw)
+	{
+		return static_cast<uint16>(FMath::RoundToInt32(FRotator::ClampAxis(Yaw) * (65536.0 / 360.0)) & 0xFFFF);
+	}
+
+	static float DequantizeYaw(uint16 Yaw)
+	{
+		return Yaw * (360.0f / 65536.0f);
+	}
+};
+
+// shared snapshot, never changes once published. holding one is a refcount
+using FSeatLayoutRef = TSharedRef<const FSeatLayout, ESPMode::ThreadSafe>;
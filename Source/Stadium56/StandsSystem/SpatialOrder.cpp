@@ -0,0 +1,264 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/SpatialOrder.h"
+#include "StandsSystem/StandsRandom.h"
+#include "StandsSystem/StandsStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/MemStack.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Misc/AutomationTest.h"
+
+void FSpatialOrder::SortByMorton(const TArray<FTransform>& Transforms, TArray<int32>& OutOrder)
+{
+	STANDS_SCOPE(STAT_Stands_MortonSort);
+
+	const int32 Num = Transforms.Num();
+	OutOrder.SetNumUninitialized(Num);
+	if (Num == 0) return;
+
+	FBox Bounds(ForceInit);
+	for (const FTransform& Transform : Transforms)
+	{
+		Bounds += Transform.GetLocation();
+	}
+
+	// one scale for all axes, keeps cells cubic
+	const double MaxExtent = FMath::Max(Bounds.GetSize().GetMax(), 1.0);
+	const double Scale = ((1 << 21) - 1) / MaxExtent;
+
+	struct FKeyedIndex
+	{
+		uint64 Key;
+		int32 Index;
+	};
+	// scratch, on this thread's mem stack
+	FMemMark Mark(FMemStack::Get());
+	TArray<FKeyedIndex, TMemStackAllocator<>> Keys;
+	Keys.SetNumUninitialized(Num);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const FVector Local = (Transforms[i].GetLocation() - Bounds.Min) * Scale;
+		Keys[i].Key = Morton3(static_cast<uint32>(Local.X), static_cast<uint32>(Local.Y), static_cast<uint32>(Local.Z));
+		Keys[i].Index = i;
+	}
+
+	Keys.Sort([](const FKeyedIndex& A, const FKeyedIndex& B)
+	{
+		return A.Key != B.Key ? A.Key < B.Key : A.Index < B.Index;
+	});
+
+	for (int32 i = 0; i < Num; ++i)
+	{
+		OutOrder[i] = Keys[i].Index;
+	}
+}
+
+#if !UE_BUILD_SHIPPING || WITH_DEV_AUTOMATION_TESTS
+
+// mean AABB surface of consecutive LeafSize groups, what a leaf cluster would get in this order
+static double MeanLeafSurface(const TArray<FTransform>& Transforms, int32 LeafSize)
+{
+	double SurfaceSum = 0.0;
+	int32 NumLeaves = 0;
+	for (int32 First = 0; First < Transforms.Num(); First += LeafSize)
+	{
+		FBox Leaf(ForceInit);
+		for (int32 i = First; i < FMath::Min(First + LeafSize, Transforms.Num()); ++i)
+		{
+			Leaf += Transforms[i].GetLocation();
+		}
+		const FVector Size = Leaf.GetSize();
+		SurfaceSum += 2.0 * (Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X);
+		++NumLeaves;
+	}
+	return NumLeaves > 0 ? SurfaceSum / NumLeaves : 0.0;
+}
+
+// rows around a bowl, rising outwards, like the spawners make them
+static void MakeBowlRows(int32 NumInstances, TArray<FTransform>& OutTransforms)
+{
+	OutTransforms.Reset(NumInstances);
+	const int32 SeatsPerRing = FMath::Max(64, NumInstances / 60);
+	for (int32 i = 0; i < NumInstances; ++i)
+	{
+		const int32 Ring = i / SeatsPerRing;
+		const double Angle = 2.0 * PI * (i % SeatsPerRing) / SeatsPerRing;
+		const double Radius = 6000.0 + Ring * 90.0;
+		OutTransforms.Add(FTransform(FVector(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), Ring * 45.0)));
+	}
+}
+
+// fisher-yates, the pick order crowd HISMs got their instances in
+static void MakeShuffle(int32 Num, int32 Seed, TArray<int32>& OutOrder)
+{
+	OutOrder.SetNumUninitialized(Num);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		OutOrder[i] = i;
+	}
+	for (int32 i = Num - 1; i > 0; --i)
+	{
+		OutOrder.Swap(i, FStandsRandom::RandRange(Seed, i, EStandsRandomStream::Mesh, 0, i));
+	}
+}
+
+#endif
+
+#if WITH_DEV_AUTOMATION_TESTS
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpatialOrderTest, "Stands.Seats.MortonOrder",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+// key bit layout, corner order, stable ties, a permutation out, Permute with a stride, and tighter leaves than random
+bool FSpatialOrderTest::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("x is bit 0"), FSpatialOrder::Morton3(1, 0, 0), 1ull);
+	TestEqual(TEXT("y is bit 1"), FSpatialOrder::Morton3(0, 1, 0), 2ull);
+	TestEqual(TEXT("z is bit 2"), FSpatialOrder::Morton3(0, 0, 1), 4ull);
+	TestEqual(TEXT("21 bits of x"), FSpatialOrder::Morton3(0x1FFFFF, 0, 0), 0x1249249249249249ull);
+	TestEqual(TEXT("bits past 21 dropped"), FSpatialOrder::Morton3(0x200000, 0, 0), 0ull);
+	TestEqual(TEXT("all 63 bits"), FSpatialOrder::Morton3(0x1FFFFF, 0x1FFFFF, 0x1FFFFF), 0x7FFFFFFFFFFFFFFFull);
+
+	// cube corners given backwards come out as x + 2y + 4z
+	TArray<FTransform> Corners;
+	for (int32 Corner = 7; Corner >= 0; --Corner)
+	{
+		Corners.Add(FTransform(FVector(Corner & 1, (Corner >> 1) & 1, (Corner >> 2) & 1) * 100.0));
+	}
+	TArray<int32> Order;
+	FSpatialOrder::SortByMorton(Corners, Order);
+	for (int32 i = 0; i < Order.Num(); ++i)
+	{
+		TestEqual(FString::Printf(TEXT("corner %d"), i), Order[i], 7 - i);
+	}
+
+	// same place, same key: input order kept
+	TArray<FTransform> Ties;
+	for (int32 i = 0; i < 5; ++i)
+	{
+		Ties.Add(FTransform(FVector(i % 2 == 0 ? 0.0 : 500.0, 0.0, 0.0)));
+	}
+	FSpatialOrder::SortByMorton(Ties, Order);
+	TestTrue(TEXT("ties keep their order"), Order == TArray<int32>({ 0, 2, 4, 1, 3 }));
+
+	// a bowl in random order: every instance once, and leaf clusters much tighter
+	const int32 NumInstances = 20000;
+	TArray<FTransform> RandomOrder;
+	MakeBowlRows(NumInstances, RandomOrder);
+	TArray<int32> Shuffle;
+	MakeShuffle(NumInstances, 4242, Shuffle);
+	FSpatialOrder::Permute(RandomOrder, Shuffle);
+
+	FSpatialOrder::SortByMorton(RandomOrder, Order);
+	TBitArray<> Seen(false, NumInstances);
+	bool bIsPermutation = Order.Num() == NumInstances;
+	for (const int32 Index : Order)
+	{
+		bIsPermutation &= Seen.IsValidIndex(Index) && !Seen[Index];
+		if (Seen.IsValidIndex(Index)) Seen[Index] = true;
+	}
+	TestTrue(TEXT("order is a permutation"), bIsPermutation);
+
+	TArray<FTransform> MortonOrder = RandomOrder;
+	FSpatialOrder::Permute(MortonOrder, Order);
+	const double RandomSurface = MeanLeafSurface(RandomOrder, 16);
+	const double MortonSurface = MeanLeafSurface(MortonOrder, 16);
+	if (MortonSurface >= RandomSurface * 0.25)
+	{
+		AddError(FString::Printf(TEXT("morton 16-leaf surface %.0f not under a quarter of random %.0f"), MortonSurface, RandomSurface));
+	}
+
+	// custom data moves with its instance, Stride floats at a time
+	TArray<float> CustomData = { 0.f, 0.5f, 1.f, 1.5f, 2.f, 2.5f };
+	FSpatialOrder::Permute(CustomData, TArray<int32>({ 2, 0, 1 }), 2);
+	TestTrue(TEXT("permute with stride"), CustomData == TArray<float>({ 2.f, 2.5f, 0.f, 0.5f, 1.f, 1.5f }));
+	return true;
+}
+#endif
+
+#if !UE_BUILD_SHIPPING
+
+// Stands.BenchInstanceOrder [Instances]
+// synthetic bowl, instances in row, random and morton order: leaf cluster surface,
+// then sync tree build time and the game thread cost of an async build on a real HISM
+static void BenchInstanceOrder(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 NumInstances = Args.Num() > 0 ? FMath::Max(100, FCString::Atoi(*Args[0])) : 100000;
+	const int32 Seed = 4242;
+
+	TArray<FTransform> RowOrder;
+	MakeBowlRows(NumInstances, RowOrder);
+
+	// crowd HISMs got their instances in pick order, effectively random
+	TArray<int32> Shuffle;
+	MakeShuffle(NumInstances, Seed, Shuffle);
+	TArray<FTransform> RandomOrder = RowOrder;
+	FSpatialOrder::Permute(RandomOrder, Shuffle);
+
+	TArray<FTransform> MortonOrder = RandomOrder;
+	TArray<int32> Order;
+	const double SortStart = FPlatformTime::Seconds();
+	FSpatialOrder::SortByMorton(MortonOrder, Order);
+	FSpatialOrder::Permute(MortonOrder, Order);
+	const double SortMs = (FPlatformTime::Seconds() - SortStart) * 1000.0;
+
+	const int32 LeafSize = 16;
+	UE_LOG(LogTemp, Log, TEXT("BenchInstanceOrder %d instances, morton sort %.2f ms. mean %d-leaf surface: row %.0f, random %.0f, morton %.0f"),
+		NumInstances, SortMs, LeafSize, MeanLeafSurface(RowOrder, LeafSize), MeanLeafSurface(RandomOrder, LeafSize), MeanLeafSurface(MortonOrder, LeafSize));
+
+	// tree build needs a registered component
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!World || !Cube)
+	{
+		UE_LOG(LogTemp, Log, TEXT("BenchInstanceOrder: no world or cube mesh, tree build skipped"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags = RF_Transient;
+	AActor* BenchActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	if (!BenchActor) return;
+
+	UHierarchicalInstancedStaticMeshComponent* HISM = NewObject<UHierarchicalInstancedStaticMeshComponent>(BenchActor);
+	HISM->SetStaticMesh(Cube);
+	HISM->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	HISM->bAutoRebuildTreeOnInstanceChanges = false;
+	BenchActor->SetRootComponent(HISM);
+	HISM->RegisterComponent();
+
+	const TPair<const TCHAR*, const TArray<FTransform>*> Orders[] = {
+		{ TEXT("row"), &RowOrder },
+		{ TEXT("random"), &RandomOrder },
+		{ TEXT("morton"), &MortonOrder },
+	};
+	for (const TPair<const TCHAR*, const TArray<FTransform>*>& Entry : Orders)
+	{
+		HISM->ClearInstances();
+		HISM->AddInstances(*Entry.Value, false, false, false);
+
+		const double SyncStart = FPlatformTime::Seconds();
+		HISM->BuildTreeIfOutdated(false, true);
+		const double SyncMs = (FPlatformTime::Seconds() - SyncStart) * 1000.0;
+
+		HISM->ClearInstances();
+		HISM->AddInstances(*Entry.Value, false, false, false);
+
+		const double AsyncStart = FPlatformTime::Seconds();
+		HISM->BuildTreeIfOutdated(true, true);
+		const double AsyncMs = (FPlatformTime::Seconds() - AsyncStart) * 1000.0;
+
+		UE_LOG(LogTemp, Log, TEXT("BenchInstanceOrder %-6s: sync tree build %.2f ms, async build game thread %.3f ms"), Entry.Key, SyncMs, AsyncMs);
+	}
+
+	BenchActor->Destroy();
+}
+
+static FAutoConsoleCommand BenchInstanceOrderCmd(
+	TEXT("Stands.BenchInstanceOrder"),
+	TEXT("Leaf cluster bounds and HISM tree build time for row, random and morton instance order. Arg: instance count (default 100000)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchInstanceOrder));
+
+#endif
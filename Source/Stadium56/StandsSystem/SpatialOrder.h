@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// z-order (morton) sort for instance lists. neighbours on the curve are neighbours in space,
+// so consecutive instances make tight HISM clusters
+struct FSpatialOrder
+{
+	// 21 bits per axis
+	static FORCEINLINE uint64 Morton3(uint32 X, uint32 Y, uint32 Z)
+	{
+		return SpreadBits3(X) | (SpreadBits3(Y) << 1) | (SpreadBits3(Z) << 2);
+	}
+
+	// OutOrder[i] = which transform goes i-th. same key keeps the old order
+	static void SortByMorton(const TArray<FTransform>& Transforms, TArray<int32>& OutOrder);
+
+	// Items[i] = old Items[Order[i]], Stride elements per entry (custom data floats)
+	template <typename T>
+	static void Permute(TArray<T>& Items, const TArray<int32>& Order, int32 Stride = 1)
+	{
+		if (Stride <= 0 || Items.Num() != Order.Num() * Stride) return;
+
+		TArray<T> Sorted;
+		Sorted.SetNumUninitialized(Items.Num());
+		for (int32 i = 0; i < Order.Num(); ++i)
+		{
+			for (int32 s = 0; s < Stride; ++s)
+			{
+				Sorted[i * Stride + s] = MoveTemp(Items[Order[i] * Stride + s]);
+			}
+		}
+		Items = MoveTemp(Sorted);
+	}
+
+private:
+	// abc -> a00b00c
+	static FORCEINLINE uint64 SpreadBits3(uint64 V)
+	{
+		V &= 0x1FFFFF;
+		V = (V | V << 32) & 0x1F00000000FFFFull;
+		V = (V | V << 16) & 0x1F0000FF0000FFull;
+		V = (V | V << 8) & 0x100F00F00F00F00Full;
+		V = (V | V << 4) & 0x10C30C30C30C30C3ull;
+		V = (V | V << 2) & 0x1249249249249249ull;
+		return V;
+	}
+};
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsAllocCounter.h"
+
+#if !UE_BUILD_SHIPPING
+
+// forwards everything to the allocator it replaced, counts the calling thread's allocations while it is counting
+class FStandsCountingMalloc final : public FMalloc
+{
+public:
+	FMalloc* Inner = nullptr;
+
+	static thread_local uint64 ThreadCount;
+	static thread_local int32 ThreadDepth;
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		ThreadCount += ThreadDepth > 0 ? 1 : 0;
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		ThreadCount += ThreadDepth > 0 ? 1 : 0;
+		return Inner->TryMalloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		ThreadCount += ThreadDepth > 0 && Count > 0 ? 1 : 0;
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		ThreadCount += ThreadDepth > 0 && Count > 0 ? 1 : 0;
+		return Inner->TryRealloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void MarkTLSCachesAsUsedOnCurrentThread() override { Inner->MarkTLSCachesAsUsedOnCurrentThread(); }
+	virtual void MarkTLSCachesAsUnusedOnCurrentThread() override { Inner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void OnMallocInitialized() override { Inner->OnMallocInitialized(); }
+	virtual void OnPreFork() override { Inner->OnPreFork(); }
+	virtual void OnPostFork() override { Inner->OnPostFork(); }
+};
+
+thread_local uint64 FStandsCountingMalloc::ThreadCount = 0;
+thread_local int32 FStandsCountingMalloc::ThreadDepth = 0;
+
+// never destroyed: another thread may still be inside it right after GMalloc is put back
+static FStandsCountingMalloc& GetCountingMalloc()
+{
+	static FStandsCountingMalloc* CountingMalloc = new FStandsCountingMalloc();
+	return *CountingMalloc;
+}
+
+FStandsAllocCountScope::FStandsAllocCountScope()
+{
+	check(IsInGameThread());
+
+	// outermost scope swaps the allocator in, nested ones only count
+	FStandsCountingMalloc& CountingMalloc = GetCountingMalloc();
+	bOuterScope = GMalloc != &CountingMalloc;
+	if (bOuterScope)
+	{
+		CountingMalloc.Inner = GMalloc;
+		GMalloc = &CountingMalloc;
+	}
+
+	++FStandsCountingMalloc::ThreadDepth;
+	StartCount = FStandsCountingMalloc::ThreadCount;
+}
+
+FStandsAllocCountScope::~FStandsAllocCountScope()
+{
+	--FStandsCountingMalloc::ThreadDepth;
+	if (bOuterScope)
+	{
+		GMalloc = GetCountingMalloc().Inner;
+	}
+}
+
+uint64 FStandsAllocCountScope::GetCount() const
+{
+	return FStandsCountingMalloc::ThreadCount - StartCount;
+}
+
+bool FStandsAllocCountScope::IsLive()
+{
+	FStandsAllocCountScope Scope;
+	void* Probe = FMemory::Malloc(64);
+	const uint64 Count = Scope.GetCount();
+	FMemory::Free(Probe);
+	return Count == 1;
+}
+
+#endif
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+// heap allocations (Malloc + Realloc) made on this thread while in scope, for the Stands alloc tests and benchmarks.
+// a forwarding FMalloc goes over GMalloc for the scope, so the count works whatever allocator the build uses
+// and other threads (render, tasks, audio) never show up in it
+class STADIUM56_API FStandsAllocCountScope
+{
+public:
+	FStandsAllocCountScope();
+	~FStandsAllocCountScope();
+
+	uint64 GetCount() const;
+
+	// a known allocation in a scope counts as exactly one. false = the numbers mean nothing
+	static bool IsLive();
+
+private:
+	uint64 StartCount;
+	bool bOuterScope;
+};
+
+#endif
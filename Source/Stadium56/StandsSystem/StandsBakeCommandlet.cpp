@@ -0,0 +1,359 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsBakeCommandlet.h"
+#include "StandsSystem/AGlobalSeatManager.h"
+#include "StandsSystem/AGlobalCrowdManager.h"
+#include "StandsSystem/ASeatSpawnerBase.h"
+#include "StandsSystem/StandsBakedData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "AssetRegistry/AssetData.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+UStandsBakeCommandlet::UStandsBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UStandsBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString MapsParam;
+	FParse::Value(*Params, TEXT("Maps="), MapsParam, false);
+	int32 NumJobs = 1;
+	FParse::Value(*Params, TEXT("Jobs="), NumJobs);
+	NumJobs = FMath::Clamp(NumJobs, 1, 64);
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+	// spawned by BakeMapsInWorkers, bakes its maps here and leaves reports
+	const bool bWorker = FParse::Param(*Params, TEXT("Worker"));
+
+	TArray<FString> Maps;
+	FindMaps(MapsParam, Maps);
+	if (Maps.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("StandsBake: no maps to bake"));
+		return 1;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FString> FailedMaps;
+	if (NumJobs > 1 && !bWorker && Maps.Num() > 1)
+	{
+		BakeMapsInWorkers(Maps, NumJobs, bSave, FailedMaps);
+	}
+	else
+	{
+		for (const FString& MapName : Maps)
+		{
+			FString Report;
+			const bool bBaked = BakeMap(MapName, bSave, Report);
+			UE_LOG(LogTemp, Display, TEXT("StandsBake %s"), *Report);
+			if (!bBaked)
+			{
+				FailedMaps.Add(MapName);
+			}
+
+			if (bWorker)
+			{
+				// status first, the parent can't tell a failed bake from the line alone
+				FFileHelper::SaveStringToFile(FString::Printf(TEXT("%s\n%s"), bBaked ? TEXT("baked") : TEXT("failed"), *Report), *GetReportFilename(MapName));
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("StandsBake %d maps in %.1f s, %d failed"), Maps.Num(), FPlatformTime::Seconds() - StartTime, FailedMaps.Num());
+	for (const FString& MapName : FailedMaps)
+	{
+		UE_LOG(LogTemp, Error, TEXT("StandsBake FAILED %s"), *MapName);
+	}
+	return FailedMaps.Num() == 0 ? 0 : 1;
+#else
+	UE_LOG(LogTemp, Error, TEXT("StandsBake needs the editor"));
+	return 1;
+#endif
+}
+
+// from the asset registry alone, no map is loaded to find out. may say yes to a map without managers, never no to one with
+static bool HasStandsManager(IAssetRegistry& AssetRegistry, const FString& PackageName, const TSet<FTopLevelAssetPath>& ManagerClasses, const TSet<FName>& ManagerPackages)
+{
+	// one file per actor: each actor package is listed with the actor's class
+	TArray<FAssetData> ExternalActors;
+	AssetRegistry.GetAssetsByPath(FName(*ULevel::GetExternalActorsPath(PackageName)), ExternalActors, true);
+	for (const FAssetData& Actor : ExternalActors)
+	{
+		if (ManagerClasses.Contains(Actor.AssetClassPath)) return true;
+	}
+
+	// actors saved in the map: it imports the package of a manager class
+	TArray<FName> Dependencies;
+	AssetRegistry.GetDependencies(FName(*PackageName), Dependencies);
+	for (const FName& Dependency : Dependencies)
+	{
+		if (ManagerPackages.Contains(Dependency)) return true;
+	}
+	return false;
+}
+
+void UStandsBakeCommandlet::FindMaps(const FString& MapsParam, TArray<FString>& OutMaps)
+{
+	TArray<FString> Wanted;
+	MapsParam.ParseIntoArray(Wanted, TEXT("+"), true);
+
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	AssetRegistry.SearchAllAssets(true);
+
+	// the managers and their blueprints
+	const TArray<FTopLevelAssetPath> BaseClasses = { AAGlobalSeatManager::StaticClass()->GetClassPathName(), AAGlobalCrowdManager::StaticClass()->GetClassPathName() };
+	TSet<FTopLevelAssetPath> ManagerClasses(BaseClasses);
+	AssetRegistry.GetDerivedClassNames(BaseClasses, {}, ManagerClasses);
+	TSet<FName> ManagerPackages;
+	for (const FTopLevelAssetPath& ClassPath : ManagerClasses)
+	{
+		ManagerPackages.Add(ClassPath.GetPackageName());
+	}
+
+	TArray<FAssetData> Worlds;
+	AssetRegistry.GetAssetsByClass(UWorld::StaticClass()->GetClassPathName(), Worlds);
+	int32 NumSkipped = 0;
+	for (const FAssetData& Asset : Worlds)
+	{
+		const FString PackageName = Asset.PackageName.ToString();
+		if (!PackageName.StartsWith(TEXT("/Game/"))) continue;
+
+		// short or long name
+		if (Wanted.Num() > 0 && !Wanted.Contains(PackageName) && !Wanted.Contains(FPackageName::GetShortName(PackageName))) continue;
+
+		if (!HasStandsManager(AssetRegistry, PackageName, ManagerClasses, ManagerPackages))
+		{
+			++NumSkipped;
+			continue;
+		}
+
+		OutMaps.AddUnique(PackageName);
+	}
+	OutMaps.Sort();
+	UE_LOG(LogTemp, Display, TEXT("StandsBake: %d maps with stands, %d without skipped unloaded"), OutMaps.Num(), NumSkipped);
+
+	for (const FString& Name : Wanted)
+	{
+		if (!OutMaps.ContainsByPredicate([&Name](const FString& Map) { return Map == Name || FPackageName::GetShortName(Map) == Name; }))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("StandsBake: no map %s, or no seat or crowd manager in it"), *Name);
+		}
+	}
+}
+
+#if WITH_EDITOR
+static bool SavePackageToDisk(UPackage* Package, UObject* Asset, const FString& Extension)
+{
+	const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), Extension);
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.SaveFlags = SAVE_NoError;
+	if (!UPackage::SavePackage(Package, Asset, *Filename, SaveArgs))
+	{
+		UE_LOG(LogTemp, Error, TEXT("StandsBake: failed to save %s"), *Filename);
+		return false;
+	}
+	return true;
+}
+#endif
+
+bool UStandsBakeCommandlet::BakeMap(const FString& MapName, bool bSave, FString& OutReport)
+{
+#if WITH_EDITOR
+	// 1. load, with a scene so the managers can register their HISMs
+	const double LoadStart = FPlatformTime::Seconds();
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		OutReport = FString::Printf(TEXT("%s: failed to load"), *MapName);
+		return false;
+	}
+
+	World->WorldType = EWorldType::Editor;
+	World->AddToRoot();
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(false)
+			.RequiresHitProxies(false)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.ShouldSimulatePhysics(false)
+			.SetTransactional(false));
+	}
+	World->UpdateWorldComponents(true, false);
+	const double LoadMs = (FPlatformTime::Seconds() - LoadStart) * 1000.0;
+
+	TArray<AAGlobalSeatManager*> SeatManagers;
+	for (TActorIterator<AAGlobalSeatManager> It(World); It; ++It)
+	{
+		SeatManagers.Add(*It);
+	}
+	TArray<AAGlobalCrowdManager*> CrowdManagers;
+	for (TActorIterator<AAGlobalCrowdManager> It(World); It; ++It)
+	{
+		CrowdManagers.Add(*It);
+	}
+
+	bool bBaked = true;
+	if (SeatManagers.Num() == 0 && CrowdManagers.Num() == 0)
+	{
+		OutReport = FString::Printf(TEXT("%s: no stands, skipped"), *MapName);
+	}
+	else
+	{
+		// 2. every spawner, natively
+		const double SeatStart = FPlatformTime::Seconds();
+		int32 NumSpawners = 0;
+		int32 NumSeats = 0;
+		for (AAGlobalSeatManager* SeatManager : SeatManagers)
+		{
+			SeatManager->RegenerateAllSeats();
+			SeatManager->FlushSeatUpdates();
+			NumSeats += SeatManager->GetSeatLayout()->Num();
+		}
+		for (TActorIterator<AASeatSpawnerBase> It(World); It; ++It)
+		{
+			NumSpawners += It->SeatManager ? 1 : 0;
+		}
+		const double SeatMs = (FPlatformTime::Seconds() - SeatStart) * 1000.0;
+
+		// 3. crowds, frozen where the seat manager has baked data
+		const double CrowdStart = FPlatformTime::Seconds();
+		int32 NumInstances = 0;
+		for (AAGlobalCrowdManager* CrowdManager : CrowdManagers)
+		{
+			const AAGlobalSeatManager* SeatManager = CrowdManager->GetSeatManager();
+			if (SeatManager && SeatManager->GetBakedData())
+			{
+				CrowdManager->BakeAndFreeze();
+			}
+			else
+			{
+				CrowdManager->BakeCrowd();
+			}
+			NumInstances += CrowdManager->GetNumCrowdInstances();
+		}
+		const double CrowdMs = (FPlatformTime::Seconds() - CrowdStart) * 1000.0;
+
+		// 4. the map, and baked data assets that changed
+		const double SaveStart = FPlatformTime::Seconds();
+		if (bSave)
+		{
+			bBaked &= SavePackageToDisk(Package, World, FPackageName::GetMapPackageExtension());
+
+			TSet<UPackage*> SavedPackages;
+			for (const AAGlobalSeatManager* SeatManager : SeatManagers)
+			{
+				UStandsBakedData* BakedData = SeatManager->GetBakedData();
+				UPackage* DataPackage = BakedData ? BakedData->GetPackage() : nullptr;
+				if (!DataPackage || !DataPackage->IsDirty() || SavedPackages.Contains(DataPackage)) continue;
+
+				SavedPackages.Add(DataPackage);
+				bBaked &= SavePackageToDisk(DataPackage, BakedData, FPackageName::GetAssetPackageExtension());
+			}
+		}
+		const double SaveMs = (FPlatformTime::Seconds() - SaveStart) * 1000.0;
+
+		OutReport = FString::Printf(TEXT("%s: %d spawners, %d seats, %d crowd instances | load %.0f ms, seats %.0f ms, crowd %.0f ms, save %.0f ms%s"),
+			*MapName, NumSpawners, NumSeats, NumInstances, LoadMs, SeatMs, CrowdMs, SaveMs, bBaked ? TEXT("") : TEXT(" | SAVE FAILED"));
+	}
+
+	// next map starts clean. the world was initialized above, so it's cleaned up before it goes
+	World->CleanupWorld();
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	return bBaked;
+#else
+	return false;
+#endif
+}
+
+void UStandsBakeCommandlet::BakeMapsInWorkers(const TArray<FString>& Maps, int32 NumJobs, bool bSave, TArray<FString>& OutFailedMaps)
+{
+	const FString ExePath = FPlatformProcess::ExecutablePath();
+	const FString ProjectPath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+
+	struct FWorker
+	{
+		FString MapName;
+		FProcHandle Handle;
+	};
+	TArray<FWorker> Running;
+	int32 NextMap = 0;
+
+	while (NextMap < Maps.Num() || Running.Num() > 0)
+	{
+		// keep NumJobs busy
+		while (Running.Num() < NumJobs && NextMap < Maps.Num())
+		{
+			const FString& MapName = Maps[NextMap++];
+			const FString ReportFile = GetReportFilename(MapName);
+			IFileManager::Get().Delete(*ReportFile, false, false, true);
+
+			const FString LogFile = FPaths::ConvertRelativePathToFull(FPaths::ProjectLogDir() / FString::Printf(TEXT("StandsBake_%s.log"), *FPackageName::GetShortName(MapName)));
+			const FString Args = FString::Printf(TEXT("\"%s\" -run=StandsBake -Worker -Maps=%s -nullrhi -unattended -nopause -nosplash%s -abslog=\"%s\""),
+				*ProjectPath, *MapName, bSave ? TEXT("") : TEXT(" -NoSave"), *LogFile);
+
+			FProcHandle Handle = FPlatformProcess::CreateProc(*ExePath, *Args, true, true, true, nullptr, 0, nullptr, nullptr);
+			if (!Handle.IsValid())
+			{
+				UE_LOG(LogTemp, Error, TEXT("StandsBake %s: worker failed to start"), *MapName);
+				OutFailedMaps.Add(MapName);
+				continue;
+			}
+			UE_LOG(LogTemp, Display, TEXT("StandsBake %s: worker started, log %s"), *MapName, *LogFile);
+			Running.Add({ MapName, Handle });
+		}
+
+		FPlatformProcess::Sleep(0.1f);
+
+		for (int32 i = Running.Num() - 1; i >= 0; --i)
+		{
+			FWorker& Worker = Running[i];
+			if (FPlatformProcess::IsProcRunning(Worker.Handle)) continue;
+
+			int32 ReturnCode = -1;
+			FPlatformProcess::GetProcReturnCode(Worker.Handle, &ReturnCode);
+			FPlatformProcess::CloseProc(Worker.Handle);
+
+			// a worker that crashed before writing its report failed, whatever its exit code
+			FString Status;
+			FString Report;
+			FString Contents;
+			if (!FFileHelper::LoadFileToString(Contents, *GetReportFilename(Worker.MapName)) || !Contents.Split(TEXT("\n"), &Status, &Report))
+			{
+				Report = FString::Printf(TEXT("%s: no report"), *Worker.MapName);
+			}
+			UE_LOG(LogTemp, Display, TEXT("StandsBake %s (worker exit %d)"), *Report, ReturnCode);
+
+			if (ReturnCode != 0 || Status != TEXT("baked"))
+			{
+				OutFailedMaps.Add(Worker.MapName);
+			}
+			Running.RemoveAtSwap(i);
+		}
+	}
+}
+
+FString UStandsBakeCommandlet::GetReportFilename(const FString& MapName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("StandsBake") / FPackageName::GetShortName(MapName) + TEXT(".txt");
+}
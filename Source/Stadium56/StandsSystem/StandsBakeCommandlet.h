@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "StandsBakeCommandlet.generated.h"
+
+// headless rebake of every map with seat or crowd managers:
+// regenerate all spawners, bake (and freeze, if the seat manager has BakedData) the crowds, save.
+//
+// UnrealEditor-Cmd Stadium56.uproject -run=StandsBake -nullrhi [-Maps=Lvl_Stadium+Lvl_TestScene] [-Jobs=4] [-NoSave]
+//   -Maps  short or long package names, default every map under /Game
+//   -Jobs  maps baked in that many worker processes at once, default 1 = this process.
+//          each worker saves its own map, maps sharing one BakedData asset must not run in parallel
+//   -NoSave  bake and report only
+UCLASS()
+class STADIUM56_API UStandsBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UStandsBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// long package names to bake: maps the asset registry says have a seat or crowd manager
+	static void FindMaps(const FString& MapsParam, TArray<FString>& OutMaps);
+
+	// load, bake, save one map in this process. false if it failed to load or any of its packages failed to save.
+	// OutReport is one line for the summary
+	static bool BakeMap(const FString& MapName, bool bSave, FString& OutReport);
+
+	// one worker process per map, at most NumJobs at a time. a map fails on a worker exit code, a failed bake or a missing report
+	static void BakeMapsInWorkers(const TArray<FString>& Maps, int32 NumJobs, bool bSave, TArray<FString>& OutFailedMaps);
+
+	// where a worker leaves its status and report line for the parent
+	static FString GetReportFilename(const FString& MapName);
+};
@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsBakedData.h"
+#include "StandsSystem/StandsStats.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+// "STND"
+static constexpr uint32 StandsBakedMagic = 0x444E5453;
+
+// count, then the raw bytes. only for plain old data
+template <typename T>
+static void SerializePod(FArchive& Ar, TArray<T>& Items)
+{
+	int32 Num = Items.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+	{
+		// truncated or garbage
+		if (Num < 0 || static_cast<int64>(Num) * sizeof(T) > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		Items.SetNumUninitialized(Num);
+	}
+	Ar.Serialize(Items.GetData(), static_cast<int64>(Num) * sizeof(T));
+}
+
+UStandsBakedData::UStandsBakedData()
+{
+	NumSeats = 0;
+	NumCrowdInstances = 0;
+	NumCrowdHISMs = 0;
+	NumCustomDataFloats = 0;
+	PayloadBytes = 0;
+	LevelSeatsHash = 0;
+	CrowdSettingsHash = 0;
+}
+
+void UStandsBakedData::Serialize(FArchive& Ar)
+{
+	LLM_SCOPE_BYTAG(Stands);
+	Super::Serialize(Ar);
+	Payload.Serialize(Ar, this);
+}
+
+void UStandsBakedData::SerializePayload(FArchive& Ar, FSeatLayout& Seats)
+{
+	uint32 Magic = StandsBakedMagic;
+	uint32 Version = PayloadVersion;
+	Ar << Magic << Version;
+	if (Ar.IsLoading() && (Magic != StandsBakedMagic || Version != PayloadVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	// seats, same arrays as FSeatLayout
+	Ar << Seats.SeatRotation << Seats.SeatScale;
+	Ar << Seats.SpawnerTransforms;
+	SerializePod(Ar, Seats.Positions);
+	SerializePod(Ar, Seats.Yaws);
+	SerializePod(Ar, Seats.SpawnerIds);
+	SerializePod(Ar, Seats.Rows);
+	SerializePod(Ar, Seats.Columns);
+
+	// crowd, per HISM in instance order
+	int32 NumHISMs = HismSeats.Num();
+	Ar << NumHISMs;
+	if (Ar.IsLoading())
+	{
+		if (Ar.IsError() || NumHISMs < 0 || NumHISMs > 4096)
+		{
+			Ar.SetError();
+			return;
+		}
+		HismSeats.SetNum(NumHISMs);
+		HismCustomData.SetNum(NumHISMs);
+	}
+	for (int32 HismIdx = 0; HismIdx < NumHISMs && !Ar.IsError(); ++HismIdx)
+	{
+		SerializePod(Ar, HismSeats[HismIdx]);
+		SerializePod(Ar, HismCustomData[HismIdx]);
+	}
+}
+
+void UStandsBakedData::Store(const FSeatLayout& Seats, const TArray<TSoftObjectPtr<AActor>>& InSpawners,
+	const TArray<TArray<int32>>& InHismSeats, const TArray<TArray<float>>& InHismCustomData, int32 InNumCustomDataFloats,
+	uint32 InLevelSeatsHash, uint32 InCrowdSettingsHash)
+{
+	LLM_SCOPE_BYTAG(Stands);
+	Spawners = InSpawners;
+	LevelSeatsHash = InLevelSeatsHash;
+	CrowdSettingsHash = InCrowdSettingsHash;
+	HismSeats = InHismSeats;
+	HismCustomData = InHismCustomData;
+	NumCustomDataFloats = InNumCustomDataFloats;
+
+	const TSharedRef<FSeatLayout, ESPMode::ThreadSafe> StoredSeats = MakeShared<FSeatLayout, ESPMode::ThreadSafe>(Seats);
+	StoredSeats->Version = FSeatLayout::NextVersion();
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	SerializePayload(Writer, *StoredSeats);
+
+	Payload.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(Payload.Realloc(Bytes.Num()), Bytes.GetData(), Bytes.Num());
+	Payload.Unlock();
+
+	// already decoded
+	DecodedSeats = StoredSeats;
+
+	NumSeats = Seats.Num();
+	NumCrowdHISMs = HismSeats.Num();
+	NumCrowdInstances = 0;
+	for (const TArray<int32>& InstanceSeats : HismSeats)
+	{
+		NumCrowdInstances += InstanceSeats.Num();
+	}
+	PayloadBytes = Bytes.Num();
+
+	MarkPackageDirty();
+}
+
+AActor* UStandsBakedData::ResolveSpawner(int32 SpawnerId, const UWorld* World) const
+{
+	if (!World || !Spawners.IsValidIndex(SpawnerId)) return nullptr;
+
+	FSoftObjectPath Path = Spawners[SpawnerId].ToSoftObjectPath();
+#if WITH_EDITOR
+	// saved against the editor level, PIE runs a UEDPIE_ copy of it
+	if (World->IsPlayInEditor())
+	{
+		Path.FixupForPIE(World->GetOutermost()->GetPIEInstanceID());
+	}
+#endif
+
+	AActor* Spawner = Cast<AActor>(Path.ResolveObject());
+	return Spawner && Spawner->GetWorld() == World ? Spawner : nullptr;
+}
+
+TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> UStandsBakedData::GetSeatLayout()
+{
+	if (DecodedSeats.IsValid() || Payload.GetBulkDataSize() == 0)
+	{
+		return DecodedSeats;
+	}
+
+	STANDS_SCOPE(STAT_Stands_DecodeBakedData);
+	const double StartTime = FPlatformTime::Seconds();
+	const TSharedRef<FSeatLayout, ESPMode::ThreadSafe> Seats = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
+
+	const uint8* Bytes = static_cast<const uint8*>(Payload.LockReadOnly());
+	FMemoryReaderView Reader(MakeArrayView(Bytes, Payload.GetBulkDataSize()));
+	SerializePayload(Reader, *Seats);
+	Payload.Unlock();
+
+	const bool bConsistent = Seats->Yaws.Num() == Seats->Num() && Seats->SpawnerIds.Num() == Seats->Num()
+		&& Seats->Rows.Num() == Seats->Num() && Seats->Columns.Num() == Seats->Num();
+	if (Reader.IsError() || !bConsistent)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: baked stands data is from an older format or damaged, bake it again"), *GetName());
+		HismSeats.Reset();
+		HismCustomData.Reset();
+		return nullptr;
+	}
+
+	Seats->Version = FSeatLayout::NextVersion();
+	DecodedSeats = Seats;
+
+	UE_LOG(LogTemp, Log, TEXT("%s: decoded %d seats, %d crowd instances (%.1f KB) in %.2f ms"),
+		*GetName(), Seats->Num(), NumCrowdInstances, Payload.GetBulkDataSize() / 1024.0, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return DecodedSeats;
+}
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Serialization/BulkData.h"
+#include "StandsSystem/SeatLayout.h"
+#include "StandsBakedData.generated.h"
+
+// frozen seats and crowd of a level. the managers upload it straight to their HISMs in game worlds,
+// no seat generation, volume filter or picks at runtime. written by AAGlobalCrowdManager::BakeAndFreeze
+UCLASS(BlueprintType)
+class STADIUM56_API UStandsBakedData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UStandsBakedData();
+
+	virtual void Serialize(FArchive& Ar) override;
+
+	// seats and their spawners, spawner id = index in Spawners
+	// per crowd HISM: the seat of each instance and its custom data, in HISM instance order
+	// the hashes are of the level's seats and the crowd settings the payload was baked from
+	void Store(const FSeatLayout& Seats, const TArray<TSoftObjectPtr<AActor>>& InSpawners,
+		const TArray<TArray<int32>>& HismSeats, const TArray<TArray<float>>& HismCustomData, int32 InNumCustomDataFloats,
+		uint32 InLevelSeatsHash, uint32 InCrowdSettingsHash);
+
+	// decoded once, then shared. nullptr if empty or from an older format
+	TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> GetSeatLayout();
+
+	bool HasCrowd() const { return NumCrowdHISMs > 0; }
+	int32 GetNumCrowdHISMs() const { return NumCrowdHISMs; }
+	int32 GetNumCustomDataFloats() const { return NumCustomDataFloats; }
+
+	// per HISM, valid after GetSeatLayout
+	const TArray<int32>& GetHismSeats(int32 HismIdx) const { return HismSeats[HismIdx]; }
+	const TArray<float>& GetHismCustomData(int32 HismIdx) const { return HismCustomData[HismIdx]; }
+
+	// spawner id -> that actor in World. a PIE world gets its own copy, never the editor level's. null if gone
+	AActor* ResolveSpawner(int32 SpawnerId, const UWorld* World) const;
+
+	// who owned spawner id i when baked, as saved in the editor level
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	TArray<TSoftObjectPtr<AActor>> Spawners;
+
+	// AAGlobalSeatManager::HashLevelSeats when baked. different -> the level's seats changed, the payload is stale
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	uint32 LevelSeatsHash;
+
+	// AAGlobalCrowdManager::HashCrowdSettings when baked. different -> the picks are stale
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	uint32 CrowdSettingsHash;
+
+	// summary, the payload itself is in bulk data
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	int32 NumSeats;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	int32 NumCrowdInstances;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	int32 NumCrowdHISMs;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	int32 NumCustomDataFloats;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	int32 PayloadBytes;
+
+private:
+	// bump when the payload layout changes, old assets then load as empty
+	static constexpr uint32 PayloadVersion = 1;
+
+	// read or write the payload. FMemoryWriter / FMemoryReaderView over the bulk data bytes
+	void SerializePayload(FArchive& Ar, FSeatLayout& Seats);
+
+	// compact binary: header, seat arrays, then per HISM seats and custom data
+	FByteBulkData Payload;
+
+	// decoded payload
+	TSharedPtr<const FSeatLayout, ESPMode::ThreadSafe> DecodedSeats;
+	TArray<TArray<int32>> HismSeats;
+	TArray<TArray<float>> HismCustomData;
+
+	friend class FStandsMemReport;
+};
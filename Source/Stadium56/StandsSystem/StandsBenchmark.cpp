@@ -0,0 +1,535 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsBenchmark.h"
+#include "StandsSystem/AGlobalSeatManager.h"
+#include "StandsSystem/AGlobalCrowdManager.h"
+#include "StandsSystem/ASeatSpawnerBase.h"
+#include "StandsSystem/CrowdBake.h"
+#include "StandsSystem/StandsAllocCounter.h"
+#include "Async/ParallelFor.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+
+UStandsBenchCommandlet::UStandsBenchCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UStandsBenchCommandlet::Main(const FString& Params)
+{
+	return FStandsBenchmark::RunSuite(Params, nullptr) ? 0 : 1;
+}
+
+#if !UE_BUILD_SHIPPING
+
+FStandsScratchWorld::FStandsScratchWorld()
+{
+	World = UWorld::CreateWorld(EWorldType::Game, false, NAME_None, nullptr, false);
+	World->AddToRoot();
+}
+
+FStandsScratchWorld::~FStandsScratchWorld()
+{
+	World->CleanupWorld();
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+}
+
+// spawners around the bowl, seats split evenly
+static constexpr int32 BenchSections = 16;
+static constexpr float BenchSpacing = 50.0f;
+// a stage this much slower than its baseline is noise, whatever the fraction
+static constexpr double BenchNoiseMs = 0.1;
+// the suite's stadiums unless -Seats/-Volumes/-Vertices say otherwise, one automation test each
+static const int32 BenchSeatCounts[] = { 1000, 10000, 100000, 1000000 };
+static const int32 BenchVolumeCounts[] = { 1, 50, 500 };
+static const int32 BenchVertexCounts[] = { 4, 64 };
+
+struct FStandsBenchmark::FConfig
+{
+	int32 NumSeats = 0;
+	int32 NumVolumes = 0;
+	int32 NumVertices = 0;
+
+	FString GetName() const { return FString::Printf(TEXT("seats%d_vol%d_vert%d"), NumSeats, NumVolumes, NumVertices); }
+};
+
+struct FStandsBenchmark::FResult
+{
+	FConfig Config;
+	FString Stage;
+	double Ms = 0.0;
+	uint64 Allocs = 0;
+	// seats or instances the stage produced
+	int32 Items = 0;
+};
+
+// best of Repeats, and the game thread allocations of that run. Func redoes the whole stage every time
+template <typename FuncType>
+static void TimeStage(int32 Repeats, double& OutMs, uint64& OutAllocs, FuncType&& Func)
+{
+	OutMs = DBL_MAX;
+	OutAllocs = 0;
+	for (int32 Run = 0; Run < Repeats; ++Run)
+	{
+		FStandsAllocCountScope AllocCount;
+		const double StartTime = FPlatformTime::Seconds();
+		Func();
+		const double Ms = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		const uint64 Allocs = AllocCount.GetCount();
+		if (Ms < OutMs)
+		{
+			OutMs = Ms;
+			OutAllocs = Allocs;
+		}
+	}
+}
+
+// one section: regular polygon with NumVertices corners, sized for its share of the seats
+static void MakeSectionInput(int32 SeatsPerSection, int32 NumVertices, FSeatGenerationInput& OutInput)
+{
+	const double Area = FMath::Max(SeatsPerSection, 1) * BenchSpacing * BenchSpacing;
+	const double Radius = FMath::Sqrt(2.0 * Area / (NumVertices * FMath::Sin(2.0 * PI / NumVertices)));
+
+	OutInput.Polygon.Reset(NumVertices);
+	OutInput.Bounds = FBox(ForceInit);
+	for (int32 i = 0; i < NumVertices; ++i)
+	{
+		const double Angle = 2.0 * PI * i / NumVertices;
+		const FVector2D Point(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle));
+		OutInput.Polygon.Add(Point);
+		OutInput.Bounds += FVector(Point, 0.0);
+	}
+	OutInput.RowSpacing = BenchSpacing;
+	OutInput.ColumnSpacing = BenchSpacing;
+	OutInput.Yaw = 0;
+}
+
+// sections on a ring wide enough that they don't overlap, facing the pitch
+static FTransform MakeSectionTransform(int32 Section, double SectionRadius)
+{
+	const double Angle = 2.0 * PI * Section / BenchSections;
+	const double RingRadius = 2000.0 + SectionRadius * BenchSections / PI;
+	return FTransform(FRotator(0.0, FMath::RadiansToDegrees(Angle) + 180.0, 0.0),
+		FVector(RingRadius * FMath::Cos(Angle), RingRadius * FMath::Sin(Angle), (Section % 2) * 100.0));
+}
+
+// NumVolumes boxes tiling the seats' XY bounds with a little overlap. every third volume brings its own weights
+static void MakeBenchContext(FCrowdBakeContext& OutContext, const TSharedRef<FSeatLayout, ESPMode::ThreadSafe>& Layout, int32 NumVolumes)
+{
+	OutContext.Seats = Layout;
+	OutContext.NumMeshes = 3;
+	OutContext.NumMats = 6;
+	OutContext.NumHISMs = OutContext.NumMeshes * OutContext.NumMats;
+	OutContext.RandomSeed = 4242;
+
+	FBox Bounds(ForceInit);
+	for (int32 i = 0; i < Layout->Num(); ++i)
+	{
+		Bounds += Layout->GetLocation(i);
+	}
+	Bounds = Bounds.ExpandBy(100.0);
+
+	const int32 GridSize = FMath::CeilToInt32(FMath::Sqrt(static_cast<float>(NumVolumes)));
+	const FVector CellSize(Bounds.GetSize().X / GridSize, Bounds.GetSize().Y / GridSize, 0.0);
+
+	TArray<float> Weights;
+	Weights.Init(1.0f, OutContext.NumMats);
+	OutContext.WeightTables.AddDefaulted_GetRef().Build(Weights);
+	Weights[0] = 10.0f;
+	OutContext.WeightTables.AddDefaulted_GetRef().Build(Weights);
+
+	for (int32 VolumeIdx = 0; VolumeIdx < NumVolumes; ++VolumeIdx)
+	{
+		const FVector Min(Bounds.Min.X + (VolumeIdx % GridSize) * CellSize.X, Bounds.Min.Y + (VolumeIdx / GridSize) * CellSize.Y, -100000.0);
+		const FVector Max(Min.X + CellSize.X, Min.Y + CellSize.Y, 100000.0);
+
+		OutContext.Volumes.Add(nullptr);
+		OutContext.VolumeBoxes.Add(FBox(Min, Max).ExpandBy(FVector(CellSize.X * 0.05, CellSize.Y * 0.05, 0.0)));
+		OutContext.VolumeSeeds.Add(VolumeIdx + 1);
+		OutContext.VolumeDensities.Add(0.8f);
+		OutContext.VolumeWeightTable.Add(VolumeIdx % 3 == 2 ? 1 : 0);
+	}
+	OutContext.VolumeGrid.Build(OutContext.VolumeBoxes);
+}
+
+void FStandsBenchmark::RunConfig(const FConfig& Config, int32 Repeats, UWorld* World, UStaticMesh* Mesh, TArray<FResult>& OutResults)
+{
+	const int32 SeatsPerSection = FMath::DivideAndRoundUp(Config.NumSeats, BenchSections);
+
+	TArray<FSeatGenerationInput> Inputs;
+	TArray<FTransform> SectionTransforms;
+	Inputs.SetNum(BenchSections);
+	for (int32 Section = 0; Section < BenchSections; ++Section)
+	{
+		MakeSectionInput(SeatsPerSection, Config.NumVertices, Inputs[Section]);
+		SectionTransforms.Add(MakeSectionTransform(Section, Inputs[Section].Bounds.GetExtent().GetMax()));
+	}
+
+	auto AddResult = [&OutResults, &Config](const TCHAR* Stage, double Ms, uint64 Allocs, int32 Items)
+	{
+		FResult& Result = OutResults.AddDefaulted_GetRef();
+		Result.Config = Config;
+		Result.Stage = Stage;
+		Result.Ms = Ms;
+		Result.Allocs = Allocs;
+		Result.Items = Items;
+		UE_LOG(LogTemp, Log, TEXT("BenchSuite %-30s %-10s %9.3f ms %8llu allocs %8d items"), *Config.GetName(), Stage, Ms, Allocs, Items);
+	};
+
+	double Ms = 0.0;
+	uint64 Allocs = 0;
+
+	// 1. seat scan of every spawner (GenerateTransforms)
+	TArray<FSeatChunkLayout> Chunks;
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		Chunks.Reset();
+		Chunks.SetNum(BenchSections);
+		for (int32 Section = 0; Section < BenchSections; ++Section)
+		{
+			AASeatSpawnerBase::GenerateSeats(Inputs[Section], Chunks[Section]);
+		}
+	});
+	int32 NumSeats = 0;
+	for (const FSeatChunkLayout& Chunk : Chunks)
+	{
+		NumSeats += Chunk.Num();
+	}
+	AddResult(TEXT("generate"), Ms, Allocs, NumSeats);
+
+	// the managers and spawners as a level has them. never constructed: no BeginPlay, no rebuilds of their own
+	AAGlobalSeatManager* SeatManager = World->SpawnActorDeferred<AAGlobalSeatManager>(AAGlobalSeatManager::StaticClass(), FTransform::Identity);
+	AAGlobalCrowdManager* CrowdManager = World->SpawnActorDeferred<AAGlobalCrowdManager>(AAGlobalCrowdManager::StaticClass(), FTransform::Identity);
+	TArray<AASeatSpawnerBase*> Spawners;
+	for (int32 Section = 0; Section < BenchSections && SeatManager; ++Section)
+	{
+		AASeatSpawnerBase* Spawner = World->SpawnActorDeferred<AASeatSpawnerBase>(AASeatSpawnerBase::StaticClass(), SectionTransforms[Section]);
+		if (!Spawner) break;
+
+		FSeatTransformChunk& Chunk = SeatManager->ChunkData.Add(Spawner);
+		Chunk.Seats = Chunks[Section];
+		Chunk.SpawnerTransform = SectionTransforms[Section];
+		Spawners.Add(Spawner);
+	}
+	if (!SeatManager || !CrowdManager || Spawners.Num() != BenchSections)
+	{
+		UE_LOG(LogTemp, Error, TEXT("BenchSuite %s: could not spawn the managers, skipped"), *Config.GetName());
+		for (AASeatSpawnerBase* Spawner : Spawners)
+		{
+			Spawner->Destroy();
+		}
+		if (SeatManager) SeatManager->Destroy();
+		if (CrowdManager) CrowdManager->Destroy();
+		return;
+	}
+
+	// 2. stitch the flat seat snapshot, a new one every time as PublishSeatLayout does (CombineSeatLayout)
+	TSharedRef<FSeatLayout, ESPMode::ThreadSafe> Layout = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
+	TArray<TWeakObjectPtr<AActor>> LayoutSpawners;
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		Layout = MakeShared<FSeatLayout, ESPMode::ThreadSafe>();
+		SeatManager->CombineSeatLayout(*Layout, LayoutSpawners);
+	});
+	Layout->Version = FSeatLayout::NextVersion();
+	AddResult(TEXT("layout"), Ms, Allocs, Layout->Num());
+
+	// 3. seat HISM transforms, morton ordered (RebuildHISMs without the upload)
+	TArray<TArray<FTransform>> ChunkTransforms;
+	ChunkTransforms.SetNum(BenchSections);
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		ParallelFor(BenchSections, [&](int32 Section)
+		{
+			AAGlobalSeatManager::CombineChunkTransforms(Chunks[Section], SectionTransforms[Section], FRotator::ZeroRotator, FVector::OneVector, ChunkTransforms[Section]);
+		});
+	});
+	AddResult(TEXT("transforms"), Ms, Allocs, NumSeats);
+
+	// 4. seat HISM upload, game thread (FillChunkHISM, the rest of RebuildHISMs)
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		for (int32 Section = 0; Section < BenchSections; ++Section)
+		{
+			SeatManager->FillChunkHISM(*SeatManager->ChunkData.Find(Spawners[Section]), ChunkTransforms[Section], Mesh);
+		}
+	});
+	AddResult(TEXT("seatupload"), Ms, Allocs, NumSeats);
+
+	// 5. snapshot hash, what a delta bake pays when the version moved
+	uint32 Hash = 0;
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		Hash = AAGlobalCrowdManager::HashSeatLayout(*Layout);
+	});
+	AddResult(TEXT("hash"), Ms, Allocs, NumSeats);
+
+	// 6. crowd: volume filter, picks, per HISM fill and morton order (GetFilteredSeatTransforms + PopulateHISMs)
+	TUniquePtr<FCrowdBakePlan> Plan;
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		Plan = MakeUnique<FCrowdBakePlan>();
+		MakeBenchContext(Plan->Context, Layout, Config.NumVolumes);
+		AAGlobalCrowdManager::BuildBakePlan(*Plan);
+	});
+	AddResult(TEXT("bakeplan"), Ms, Allocs, Plan->NumInstances);
+
+	// 7. crowd HISM upload, game thread (BakeCrowd's clear, bookkeeping and ApplyBakePlan)
+	for (int32 HismIdx = 0; HismIdx < Plan->Context.NumHISMs; ++HismIdx)
+	{
+		UHierarchicalInstancedStaticMeshComponent* HISM = NewObject<UHierarchicalInstancedStaticMeshComponent>(CrowdManager, NAME_None, RF_Transient);
+		HISM->SetStaticMesh(Mesh);
+		HISM->SetNumCustomDataFloats(CrowdCustomData::NumPerClipHISM);
+		HISM->bAutoRebuildTreeOnInstanceChanges = false;
+		HISM->RegisterComponent();
+		CrowdManager->CrowdHISMs.Add(HISM);
+	}
+	TimeStage(Repeats, Ms, Allocs, [&]()
+	{
+		CrowdManager->ClearCrowd();
+		CrowdManager->ResetDeltaBookkeeping(Plan->Context);
+		Plan->ApplyHism = 0;
+		Plan->ApplyInstance = 0;
+		Plan->NumApplied = 0;
+		CrowdManager->ApplyBakePlan(*Plan, DBL_MAX, MAX_int32);
+	});
+	AddResult(TEXT("crowdupload"), Ms, Allocs, Plan->NumApplied);
+
+	for (AASeatSpawnerBase* Spawner : Spawners)
+	{
+		Spawner->Destroy();
+	}
+	SeatManager->Destroy();
+	CrowdManager->Destroy();
+}
+
+void FStandsBenchmark::WriteResults(const TArray<FResult>& Results, const FString& BaseName)
+{
+	FString Csv = TEXT("config,seats,volumes,vertices,stage,ms,allocs,items\n");
+	FString Json = FString::Printf(TEXT("{\n\t\"timestamp\": \"%s\",\n\t\"platform\": \"%s\",\n\t\"results\": [\n"),
+		*FDateTime::UtcNow().ToIso8601(), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()));
+
+	for (int32 i = 0; i < Results.Num(); ++i)
+	{
+		const FResult& Result = Results[i];
+		Csv += FString::Printf(TEXT("%s,%d,%d,%d,%s,%.4f,%llu,%d\n"), *Result.Config.GetName(), Result.Config.NumSeats, Result.Config.NumVolumes,
+			Result.Config.NumVertices, *Result.Stage, Result.Ms, Result.Allocs, Result.Items);
+		Json += FString::Printf(TEXT("\t\t{ \"config\": \"%s\", \"seats\": %d, \"volumes\": %d, \"vertices\": %d, \"stage\": \"%s\", \"ms\": %.4f, \"allocs\": %llu, \"items\": %d }%s\n"),
+			*Result.Config.GetName(), Result.Config.NumSeats, Result.Config.NumVolumes, Result.Config.NumVertices, *Result.Stage,
+			Result.Ms, Result.Allocs, Result.Items, i + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+	}
+	Json += TEXT("\t]\n}\n");
+
+	FFileHelper::SaveStringToFile(Csv, *(BaseName + TEXT(".csv")));
+	FFileHelper::SaveStringToFile(Json, *(BaseName + TEXT(".json")));
+}
+
+int32 FStandsBenchmark::CompareBaseline(const TArray<FResult>& Results, const FString& BaselineFile, double Threshold, bool bCompareAllocs)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *BaselineFile))
+	{
+		UE_LOG(LogTemp, Log, TEXT("BenchSuite: no baseline at %s, run with -SaveBaseline to make one"), *BaselineFile);
+		return 0;
+	}
+
+	// config,stage -> ms, allocs
+	TMap<FString, TPair<double, uint64>> Baseline;
+	for (int32 i = 1; i < Lines.Num(); ++i)
+	{
+		TArray<FString> Fields;
+		Lines[i].ParseIntoArray(Fields, TEXT(","), false);
+		if (Fields.Num() < 7) continue;
+		Baseline.Add(Fields[0] + TEXT("/") + Fields[4], TPair<double, uint64>(FCString::Atod(*Fields[5]), FCString::Strtoui64(*Fields[6], nullptr, 10)));
+	}
+
+	int32 NumRegressions = 0;
+	for (const FResult& Result : Results)
+	{
+		const TPair<double, uint64>* Base = Baseline.Find(Result.Config.GetName() + TEXT("/") + Result.Stage);
+		if (!Base) continue;
+
+		const bool bSlower = Result.Ms > Base->Key * (1.0 + Threshold) && Result.Ms - Base->Key > BenchNoiseMs;
+		// a few allocations of slack for the task system
+		const bool bMoreAllocs = bCompareAllocs && Result.Allocs > Base->Value * (1.0 + Threshold) + 16;
+		if (bSlower || bMoreAllocs)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("BenchSuite REGRESSION %s %s: %.3f ms (baseline %.3f), %llu allocs (baseline %llu)"),
+				*Result.Config.GetName(), *Result.Stage, Result.Ms, Base->Key, Result.Allocs, Base->Value);
+			++NumRegressions;
+		}
+	}
+	return NumRegressions;
+}
+
+// "1000+10000" -> { 1000, 10000 }
+static void ParseIntList(const FString& Params, const TCHAR* Key, TArray<int32>& InOutValues)
+{
+	FString Value;
+	if (!FParse::Value(*Params, Key, Value, false)) return;
+
+	TArray<FString> Items;
+	Value.ParseIntoArray(Items, TEXT("+"), true);
+	InOutValues.Reset();
+	for (const FString& Item : Items)
+	{
+		InOutValues.Add(FCString::Atoi(*Item));
+	}
+}
+
+bool FStandsBenchmark::RunSuite(const FString& Params, UWorld* World)
+{
+	TArray<int32> SeatCounts(BenchSeatCounts, UE_ARRAY_COUNT(BenchSeatCounts));
+	TArray<int32> VolumeCounts(BenchVolumeCounts, UE_ARRAY_COUNT(BenchVolumeCounts));
+	TArray<int32> VertexCounts(BenchVertexCounts, UE_ARRAY_COUNT(BenchVertexCounts));
+	ParseIntList(Params, TEXT("Seats="), SeatCounts);
+	ParseIntList(Params, TEXT("Volumes="), VolumeCounts);
+	ParseIntList(Params, TEXT("Vertices="), VertexCounts);
+
+	int32 Repeats = 3;
+	FParse::Value(*Params, TEXT("Repeats="), Repeats);
+	Repeats = FMath::Max(Repeats, 1);
+	double Threshold = 0.1;
+	FParse::Value(*Params, TEXT("Threshold="), Threshold);
+
+	const FString OutDir = FPaths::ProjectSavedDir() / TEXT("StandsBench");
+	FString BaselineFile = OutDir / TEXT("Baseline.csv");
+	FParse::Value(*Params, TEXT("Baseline="), BaselineFile);
+	// runs of one config each keep their files apart
+	FString RunName;
+	FParse::Value(*Params, TEXT("Name="), RunName);
+	const FString NameSuffix = RunName.IsEmpty() ? FString() : TEXT("_") + RunName;
+
+	// allocator without the counting proxy under it, times only
+	const bool bAllocsLive = FStandsAllocCountScope::IsLive();
+	if (!bAllocsLive)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BenchSuite: allocations are not counted in this process, comparing times only"));
+	}
+
+	// the commandlet and the automation tests have no world, the upload stages need one to register their HISMs
+	TOptional<FStandsScratchWorld> ScratchWorld;
+	if (!World)
+	{
+		World = ScratchWorld.Emplace().Get();
+	}
+	UStaticMesh* Mesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FResult> Results;
+	for (const int32 NumSeats : SeatCounts)
+	{
+		for (const int32 NumVolumes : VolumeCounts)
+		{
+			for (const int32 NumVertices : VertexCounts)
+			{
+				FConfig Config;
+				Config.NumSeats = FMath::Max(NumSeats, BenchSections);
+				Config.NumVolumes = FMath::Max(NumVolumes, 1);
+				Config.NumVertices = FMath::Max(NumVertices, 3);
+				RunConfig(Config, Repeats, World, Mesh, Results);
+			}
+		}
+	}
+
+	const FString BaseName = OutDir / FString::Printf(TEXT("Bench%s_%s"), *NameSuffix, *FDateTime::Now().ToString());
+	WriteResults(Results, BaseName);
+	WriteResults(Results, OutDir / (TEXT("Latest") + NameSuffix));
+	ScratchWorld.Reset();
+
+	// a new baseline has nothing to regress against
+	int32 NumRegressions = 0;
+	if (FParse::Param(*Params, TEXT("SaveBaseline")))
+	{
+		IFileManager::Get().Copy(*BaselineFile, *(BaseName + TEXT(".csv")));
+		UE_LOG(LogTemp, Log, TEXT("BenchSuite: baseline saved to %s"), *BaselineFile);
+	}
+	else
+	{
+		NumRegressions = CompareBaseline(Results, BaselineFile, Threshold, bAllocsLive);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("BenchSuite %d results in %.1f s, %s.csv/.json, %d regressions (threshold %.0f%%)"),
+		Results.Num(), FPlatformTime::Seconds() - StartTime, *BaseName, NumRegressions, Threshold * 100.0);
+	return NumRegressions == 0;
+}
+
+static void BenchSuite(const TArray<FString>& Args, UWorld* World)
+{
+	FStandsBenchmark::RunSuite(FString::Join(Args, TEXT(" ")), World);
+}
+
+static FAutoConsoleCommand BenchSuiteCmd(
+	TEXT("Stands.BenchSuite"),
+	TEXT("Time and count allocations of every stands stage on synthetic stadiums, write JSON/CSV to Saved/StandsBench and compare with the baseline. Args: -Seats=1000+1000000 -Volumes=1+500 -Vertices=4+64 -Repeats=3 -Threshold=0.1 -Baseline=<csv> -SaveBaseline"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchSuite));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// one perf test per suite stadium, failing on a regression against the baseline:
+// UnrealEditor-Cmd Stadium56.uproject -ExecCmds="Automation RunTests Stands.Bench; Quit" -nullrhi -unattended [-Repeats= -Threshold= -Baseline=]
+// the baseline is still made by the console command or the commandlet with -SaveBaseline
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FStandsBenchSuiteTest, "Stands.Bench.Suite",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FStandsBenchSuiteTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const int32 NumSeats : BenchSeatCounts)
+	{
+		for (const int32 NumVolumes : BenchVolumeCounts)
+		{
+			for (const int32 NumVertices : BenchVertexCounts)
+			{
+				const FString Name = FString::Printf(TEXT("seats%d_vol%d_vert%d"), NumSeats, NumVolumes, NumVertices);
+				OutBeautifiedNames.Add(Name);
+				OutTestCommands.Add(FString::Printf(TEXT("-Seats=%d -Volumes=%d -Vertices=%d -Name=%s"), NumSeats, NumVolumes, NumVertices, *Name));
+			}
+		}
+	}
+}
+
+bool FStandsBenchSuiteTest::RunTest(const FString& Parameters)
+{
+	// repeats, threshold and baseline from the command line. the config params come first and win
+	FString Params = Parameters;
+	const TCHAR* CmdLine = FCommandLine::Get();
+	FString Value;
+	for (const TCHAR* Key : { TEXT("Repeats="), TEXT("Threshold="), TEXT("Baseline=") })
+	{
+		if (FParse::Value(CmdLine, Key, Value, false))
+		{
+			Params += FString::Printf(TEXT(" -%s\"%s\""), Key, *Value);
+		}
+	}
+
+	if (!FStandsBenchmark::RunSuite(Params, nullptr))
+	{
+		AddError(FString::Printf(TEXT("%s regressed against the baseline, see the log for the stages"), *Parameters));
+	}
+	return true;
+}
+
+#endif
+
+#else
+
+bool FStandsBenchmark::RunSuite(const FString& Params, UWorld* World)
+{
+	UE_LOG(LogTemp, Warning, TEXT("StandsBench is not in shipping builds"));
+	return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "StandsBenchmark.generated.h"
+
+class UStaticMesh;
+
+// stands pipeline on procedural stadiums, non-shipping. every stage timed (best of Repeats) with its
+// game thread allocation count, written to Saved/StandsBench as JSON and CSV, then compared against a baseline CSV.
+// the HISM uploads run on managers spawned in the console's world, or a scratch world in the commandlet and the tests
+//
+// Stands.BenchSuite [params] in the console, the Stands.Bench.Suite automation tests (one per default stadium), or headless:
+// UnrealEditor-Cmd Stadium56.uproject -run=StandsBench -nullrhi [params]
+//   -Seats=1000+10000+100000+1000000  -Volumes=1+50+500  -Vertices=4+64
+//   -Repeats=3
+//   -Baseline=<csv>  default Saved/StandsBench/Baseline.csv
+//   -Threshold=0.1  slower (or more allocations) by more than this fraction is a regression
+//   -SaveBaseline  this run becomes the baseline, nothing is compared
+//   -Name=<name>  appended to the result file names
+class STADIUM56_API FStandsBenchmark
+{
+public:
+	// false on a regression against the baseline. World null: a scratch world for the run
+	static bool RunSuite(const FString& Params, UWorld* World);
+
+private:
+	struct FConfig;
+	struct FResult;
+
+	// one stadium, every stage
+	static void RunConfig(const FConfig& Config, int32 Repeats, UWorld* World, UStaticMesh* Mesh, TArray<FResult>& OutResults);
+
+	static void WriteResults(const TArray<FResult>& Results, const FString& BaseName);
+
+	// logs each regression, returns how many. bCompareAllocs false: times only
+	static int32 CompareBaseline(const TArray<FResult>& Results, const FString& BaselineFile, double Threshold, bool bCompareAllocs);
+};
+
+#if !UE_BUILD_SHIPPING
+// a game world of its own for the suite and the stands automation tests, rooted while in scope.
+// nothing in it ticks, spawned managers stay deferred unless the caller finishes them
+class STADIUM56_API FStandsScratchWorld
+{
+public:
+	FStandsScratchWorld();
+	~FStandsScratchWorld();
+
+	UWorld* Get() const { return World; }
+
+private:
+	UWorld* World = nullptr;
+};
+#endif
+
+// FStandsBenchmark::RunSuite as a commandlet, exit code 1 on a regression
+UCLASS()
+class STADIUM56_API UStandsBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UStandsBenchCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
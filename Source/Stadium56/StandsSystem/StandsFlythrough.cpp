@@ -0,0 +1,453 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsFlythrough.h"
+#include "StandsSystem/AGlobalSeatManager.h"
+#include "StandsSystem/AGlobalCrowdManager.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SplineComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "RenderCore.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+CSV_DEFINE_CATEGORY(StandsFlythrough, true);
+
+// a segment this much slower than its baseline is noise, whatever the fraction
+static constexpr double FlythroughNoiseMs = 0.1;
+
+AStandsFlythroughGameMode::AStandsFlythroughGameMode()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PlayerControllerClass = AStandsFlythroughPlayerController::StaticClass();
+	bStartPlayersAsSpectators = true;
+
+	FlythroughSeconds = 60.0f;
+	WarmupSeconds = 3.0f;
+	FixedFps = 30.0f;
+	PathTag = TEXT("StandsFlythrough");
+	NumOrbitPoints = 8;
+	FieldOfView = 90.0f;
+	Path = nullptr;
+}
+
+void AStandsFlythroughGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("FlythroughSeconds="), FlythroughSeconds);
+	FParse::Value(CommandLine, TEXT("FlythroughWarmup="), WarmupSeconds);
+	FParse::Value(CommandLine, TEXT("FlythroughFps="), FixedFps);
+	FlythroughSeconds = FMath::Max(FlythroughSeconds, 1.0f);
+	FixedFps = FMath::Max(FixedFps, 1.0f);
+
+	BaselineFile = FPaths::ProjectSavedDir() / TEXT("StandsBench") / TEXT("FlythroughBaseline.csv");
+	FParse::Value(CommandLine, TEXT("Baseline="), BaselineFile);
+	FParse::Value(CommandLine, TEXT("Threshold="), Threshold);
+	bSaveBaseline = FParse::Param(CommandLine, TEXT("SaveBaseline"));
+	bExitWhenDone = !FParse::Param(CommandLine, TEXT("NoExit")) && !GIsEditor;
+
+	// HISM instances are culled while the renderer gathers the views' meshes
+	FString CullStats = TEXT("InitViews");
+	FParse::Value(CommandLine, TEXT("CullStats="), CullStats, false);
+	CullStats.ParseIntoArray(CullStatNames, TEXT("+"), true);
+
+	// same frame, same camera, however long the frame took
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / FixedFps);
+}
+
+void AStandsFlythroughGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+#if CSV_PROFILER
+	if (Phase == EPhase::Capture && FCsvProfiler::Get()->IsCapturing())
+	{
+		FCsvProfiler::Get()->EndCapture();
+	}
+#endif
+	FApp::SetUseFixedTimeStep(false);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool AStandsFlythroughGameMode::BuildPath()
+{
+	UWorld* World = GetWorld();
+	if (!World) return false;
+
+	// seats, whatever they came from
+	FBox SeatBounds(ForceInit);
+	for (TActorIterator<AAGlobalSeatManager> It(World); It; ++It)
+	{
+		It->FlushSeatUpdates();
+		const FSeatLayoutRef Seats = It->GetSeatLayout();
+		for (int32 i = 0; i < Seats->Num(); ++i)
+		{
+			SeatBounds += Seats->GetLocation(i);
+		}
+	}
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		USplineComponent* Spline = It->ActorHasTag(PathTag) ? It->FindComponentByClass<USplineComponent>() : nullptr;
+		if (Spline && Spline->GetNumberOfSplineSegments() > 0)
+		{
+			Path = Spline;
+			bLookAtTarget = false;
+			UE_LOG(LogTemp, Log, TEXT("Flythrough: path %s, %d segments, %.0f cm"), *It->GetName(), Path->GetNumberOfSplineSegments(), Path->GetSplineLength());
+			return true;
+		}
+	}
+
+	if (!SeatBounds.IsValid) return false;
+
+	// closed loop, even points over the top rows, odd points down at pitch level
+	const FVector Center = SeatBounds.GetCenter();
+	const FVector Extent = SeatBounds.GetExtent();
+	const double Radius = FMath::Max(Extent.X, Extent.Y);
+
+	Path = NewObject<USplineComponent>(this, TEXT("FlythroughPath"));
+	Path->RegisterComponent();
+	Path->ClearSplinePoints(false);
+	for (int32 i = 0; i < NumOrbitPoints; ++i)
+	{
+		const double Angle = 2.0 * PI * i / NumOrbitPoints;
+		const bool bHigh = i % 2 == 0;
+		const double PointRadius = Radius * (bHigh ? 1.15 : 0.45);
+		const double PointZ = bHigh ? SeatBounds.Max.Z + Extent.Z * 0.5 + 300.0 : SeatBounds.Min.Z + 200.0;
+		Path->AddSplinePoint(FVector(Center.X + PointRadius * FMath::Cos(Angle), Center.Y + PointRadius * FMath::Sin(Angle), PointZ), ESplineCoordinateSpace::World, false);
+	}
+	Path->SetClosedLoop(true, false);
+	Path->UpdateSpline();
+
+	LookAtTarget = Center;
+	bLookAtTarget = true;
+	UE_LOG(LogTemp, Log, TEXT("Flythrough: orbit of %d points around %s, %.0f cm, %d instances"),
+		NumOrbitPoints, *Center.ToString(), Path->GetSplineLength(), CountInstances());
+	return true;
+}
+
+bool AStandsFlythroughGameMode::GetFlythroughView(FMinimalViewInfo& OutView) const
+{
+	if (!Path) return false;
+
+	const double Alpha = Phase == EPhase::Capture ? FMath::Clamp(PhaseTime / FlythroughSeconds, 0.0, 1.0) : (Phase == EPhase::Done ? 1.0 : 0.0);
+	const float Distance = Alpha * Path->GetSplineLength();
+
+	OutView.Location = Path->GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+	OutView.Rotation = bLookAtTarget ? (LookAtTarget - OutView.Location).Rotation() : Path->GetRotationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+	OutView.FOV = FieldOfView;
+	// no viewport under -nullrhi, and the view has to match between machines
+	OutView.AspectRatio = 16.0f / 9.0f;
+	OutView.bConstrainAspectRatio = true;
+	return true;
+}
+
+int32 AStandsFlythroughGameMode::CountInstances() const
+{
+	int32 NumInstances = 0;
+	auto AddComponents = [&NumInstances](const AActor* Manager)
+	{
+		TInlineComponentArray<UInstancedStaticMeshComponent*> Components(Manager);
+		for (const UInstancedStaticMeshComponent* Component : Components)
+		{
+			NumInstances += Component->IsVisible() ? Component->GetInstanceCount() : 0;
+		}
+	};
+	for (TActorIterator<AAGlobalSeatManager> It(GetWorld()); It; ++It)
+	{
+		AddComponents(*It);
+	}
+	for (TActorIterator<AAGlobalCrowdManager> It(GetWorld()); It; ++It)
+	{
+		AddComponents(*It);
+	}
+	return NumInstances;
+}
+
+void AStandsFlythroughGameMode::Sample(double FrameMs)
+{
+	if (!Path) return;
+
+	// last point whose distance we passed
+	const float Distance = FMath::Clamp(PhaseTime / FlythroughSeconds, 0.0, 1.0) * Path->GetSplineLength();
+	int32 Segment = 0;
+	while (Segment + 1 < Segments.Num() && Path->GetDistanceAlongSplineAtSplinePoint(Segment + 1) <= Distance)
+	{
+		++Segment;
+	}
+	if (Segment != CurrentSegment)
+	{
+		CurrentSegment = Segment;
+		CSV_EVENT(StandsFlythrough, TEXT("Segment %d"), Segment);
+	}
+
+	// last frame's threads, the fly-through adds nothing to them but this count
+	const double GameMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	const double RenderMs = FPlatformTime::ToMilliseconds(GRenderThreadTime);
+	const int32 Instances = CountInstances();
+
+	FSegmentStats& Stats = Segments[Segment];
+	++Stats.Frames;
+	Stats.FrameMs += FrameMs;
+	Stats.GameMs += GameMs;
+	Stats.GameMaxMs = FMath::Max(Stats.GameMaxMs, GameMs);
+	Stats.RenderMs += RenderMs;
+	Stats.RenderMaxMs = FMath::Max(Stats.RenderMaxMs, RenderMs);
+	Stats.Instances += Instances;
+
+	// ReadCullStats finds each frame's segment by this column
+	CSV_CUSTOM_STAT(StandsFlythrough, Segment, Segment, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(StandsFlythrough, Instances, Instances, ECsvCustomStatOp::Set);
+}
+
+void AStandsFlythroughGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const double Now = FPlatformTime::Seconds();
+	const double FrameMs = LastFrameTime > 0.0 ? (Now - LastFrameTime) * 1000.0 : 0.0;
+	LastFrameTime = Now;
+	PhaseTime += DeltaSeconds;
+
+	switch (Phase)
+	{
+	case EPhase::Warmup:
+		// first tick, every actor has begun play. the camera waits at the start
+		if (!Path && !BuildPath())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Flythrough: no path tagged %s and no seats to orbit"), *PathTag.ToString());
+			Phase = EPhase::Done;
+			bSummaryWritten = true;
+			ExitCode = 1;
+			bExitPending = bExitWhenDone;
+			return;
+		}
+		if (PhaseTime < WarmupSeconds) return;
+
+#if CSV_PROFILER
+		CsvFile = FPaths::ProjectSavedDir() / TEXT("StandsBench") / FString::Printf(TEXT("Flythrough_%s_%s.csv"), *GetWorld()->GetName(), *FDateTime::Now().ToString());
+		FCsvProfiler::Get()->BeginCapture(-1, FPaths::GetPath(CsvFile), FPaths::GetCleanFilename(CsvFile));
+#endif
+		Segments.Reset();
+		Segments.SetNum(Path->GetNumberOfSplineSegments());
+		CurrentSegment = INDEX_NONE;
+		Phase = EPhase::Capture;
+		PhaseTime = 0.0;
+		UE_LOG(LogTemp, Log, TEXT("Flythrough: capturing %.0f s at %.0f fps"), FlythroughSeconds, FixedFps);
+		break;
+
+	case EPhase::Capture:
+		if (PhaseTime >= FlythroughSeconds)
+		{
+			Finish();
+			return;
+		}
+		Sample(FrameMs);
+		break;
+
+	case EPhase::Done:
+#if CSV_PROFILER
+		// the capture ends at the end of a frame and writes on a thread
+		if (FCsvProfiler::Get()->IsCapturing() || FCsvProfiler::Get()->IsWritingFile()) return;
+#endif
+		if (!bSummaryWritten)
+		{
+			bSummaryWritten = true;
+			if (!ReadCullStats())
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Flythrough: no %s timings in the capture, cull_ms is 0"), *FString::Join(CullStatNames, TEXT("+")));
+			}
+			ExitCode = WriteSummary() > 0 ? 1 : 0;
+		}
+		if (bExitPending)
+		{
+			bExitPending = false;
+			FPlatformMisc::RequestExitWithStatus(false, static_cast<uint8>(ExitCode));
+		}
+		break;
+	}
+}
+
+void AStandsFlythroughGameMode::Finish()
+{
+	Phase = EPhase::Done;
+#if CSV_PROFILER
+	FCsvProfiler::Get()->EndCapture();
+#endif
+
+	// the summary waits for the capture file, it has the cull timings
+	bExitPending = bExitWhenDone;
+}
+
+bool AStandsFlythroughGameMode::ReadCullStats()
+{
+	TArray<FString> Lines;
+	if (CsvFile.IsEmpty() || !FFileHelper::LoadFileToStringArray(Lines, *CsvFile) || Lines.Num() < 2) return false;
+
+	TArray<FString> Header;
+	Lines[0].ParseIntoArray(Header, TEXT(","), false);
+	int32 SegmentColumn = INDEX_NONE;
+	TArray<int32> CullColumns;
+	for (int32 Column = 0; Column < Header.Num(); ++Column)
+	{
+		const FString Name = Header[Column].TrimStartAndEnd();
+		if (Name == TEXT("StandsFlythrough/Segment"))
+		{
+			SegmentColumn = Column;
+			continue;
+		}
+
+		// inclusive timings, the Exclusive/ copies would count the same time twice
+		if (Name.StartsWith(TEXT("Exclusive/"))) continue;
+		FString ShortName = Name;
+		Name.Split(TEXT("/"), nullptr, &ShortName, ESearchCase::CaseSensitive, ESearchDir::FromEnd);
+		if (CullStatNames.Contains(ShortName))
+		{
+			CullColumns.Add(Column);
+		}
+	}
+	if (SegmentColumn == INDEX_NONE || CullColumns.Num() == 0) return false;
+
+	for (int32 i = 1; i < Lines.Num(); ++i)
+	{
+		TArray<FString> Fields;
+		Lines[i].ParseIntoArray(Fields, TEXT(","), false);
+		// the header again and the metadata after the frames, frames before the first sample
+		if (Fields.Num() != Header.Num() || !Fields[SegmentColumn].IsNumeric()) continue;
+
+		const int32 Segment = FCString::Atoi(*Fields[SegmentColumn]);
+		if (!Segments.IsValidIndex(Segment)) continue;
+
+		double CullMs = 0.0;
+		for (const int32 Column : CullColumns)
+		{
+			CullMs += FCString::Atod(*Fields[Column]);
+		}
+		FSegmentStats& Stats = Segments[Segment];
+		++Stats.CullFrames;
+		Stats.CullMs += CullMs;
+		Stats.CullMaxMs = FMath::Max(Stats.CullMaxMs, CullMs);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Flythrough: cull timings from %d columns of %s"), CullColumns.Num(), *CsvFile);
+	return true;
+}
+
+int32 AStandsFlythroughGameMode::WriteSummary() const
+{
+	const FString MapName = GetWorld()->GetName();
+	FString Csv = TEXT("map,segment,frames,frame_ms,game_ms,game_max_ms,render_ms,render_max_ms,cull_ms,cull_max_ms,instances\n");
+	FString Json = FString::Printf(TEXT("{\n\t\"timestamp\": \"%s\",\n\t\"platform\": \"%s\",\n\t\"map\": \"%s\",\n\t\"seconds\": %.1f,\n\t\"fps\": %.1f,\n\t\"nullrhi\": %s,\n\t\"segments\": [\n"),
+		*FDateTime::UtcNow().ToIso8601(), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()), *MapName, FlythroughSeconds, FixedFps,
+		GUsingNullRHI ? TEXT("true") : TEXT("false"));
+
+	// per segment averages, keyed map/segment against the baseline. segments without cull timings skip that check
+	TMap<FString, FVector3d> Results;
+	TSet<FString> NoCull;
+	for (int32 Segment = 0; Segment < Segments.Num(); ++Segment)
+	{
+		const FSegmentStats& Stats = Segments[Segment];
+		const double Frames = FMath::Max(Stats.Frames, 1);
+		const double FrameMs = Stats.FrameMs / Frames;
+		const double GameMs = Stats.GameMs / Frames;
+		const double RenderMs = Stats.RenderMs / Frames;
+		const double CullMs = Stats.CullMs / FMath::Max(Stats.CullFrames, 1);
+		const int64 Instances = Stats.Instances / static_cast<int64>(Frames);
+		const FString Key = FString::Printf(TEXT("%s/%d"), *MapName, Segment);
+		Results.Add(Key, FVector3d(GameMs, RenderMs, CullMs));
+		if (Stats.CullFrames == 0)
+		{
+			NoCull.Add(Key);
+		}
+
+		Csv += FString::Printf(TEXT("%s,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%lld\n"), *MapName, Segment, Stats.Frames,
+			FrameMs, GameMs, Stats.GameMaxMs, RenderMs, Stats.RenderMaxMs, CullMs, Stats.CullMaxMs, Instances);
+		Json += FString::Printf(TEXT("\t\t{ \"segment\": %d, \"frames\": %d, \"frame_ms\": %.4f, \"game_ms\": %.4f, \"game_max_ms\": %.4f, \"render_ms\": %.4f, \"render_max_ms\": %.4f, \"cull_ms\": %.4f, \"cull_max_ms\": %.4f, \"instances\": %lld }%s\n"),
+			Segment, Stats.Frames, FrameMs, GameMs, Stats.GameMaxMs, RenderMs, Stats.RenderMaxMs, CullMs, Stats.CullMaxMs, Instances,
+			Segment + 1 < Segments.Num() ? TEXT(",") : TEXT(""));
+		UE_LOG(LogTemp, Log, TEXT("Flythrough segment %2d: %4d frames, frame %7.2f ms, game %7.2f ms, render %7.2f ms, cull %6.2f ms, %lld instances"),
+			Segment, Stats.Frames, FrameMs, GameMs, RenderMs, CullMs, Instances);
+	}
+	Json += TEXT("\t]\n}\n");
+
+	const FString OutDir = FPaths::ProjectSavedDir() / TEXT("StandsBench");
+	const FString BaseName = OutDir / FString::Printf(TEXT("Flythrough_%s_%s"), *MapName, *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Csv, *(BaseName + TEXT(".csv")));
+	FFileHelper::SaveStringToFile(Json, *(BaseName + TEXT(".json")));
+	FFileHelper::SaveStringToFile(Csv, *(OutDir / TEXT("FlythroughLatest.csv")));
+	FFileHelper::SaveStringToFile(Json, *(OutDir / TEXT("FlythroughLatest.json")));
+
+	// game, render and cull averages, same rule as the bench suite
+	int32 NumRegressions = 0;
+	TArray<FString> Lines;
+	if (FFileHelper::LoadFileToStringArray(Lines, *BaselineFile))
+	{
+		for (int32 i = 1; i < Lines.Num(); ++i)
+		{
+			TArray<FString> Fields;
+			Lines[i].ParseIntoArray(Fields, TEXT(","), false);
+			if (Fields.Num() < 11) continue;
+
+			const FString Key = Fields[0] + TEXT("/") + Fields[1];
+			const FVector3d* Result = Results.Find(Key);
+			if (!Result) continue;
+
+			const FVector3d Base(FCString::Atod(*Fields[4]), FCString::Atod(*Fields[6]), FCString::Atod(*Fields[8]));
+			const TCHAR* Names[] = { TEXT("game"), TEXT("render"), TEXT("cull") };
+			const int32 NumStats = NoCull.Contains(Key) ? 2 : 3;
+			for (int32 Stat = 0; Stat < NumStats; ++Stat)
+			{
+				if ((*Result)[Stat] > Base[Stat] * (1.0 + Threshold) && (*Result)[Stat] - Base[Stat] > FlythroughNoiseMs)
+				{
+					UE_LOG(LogTemp, Warning, TEXT("Flythrough REGRESSION %s segment %s %s: %.3f ms (baseline %.3f)"),
+						*MapName, *Fields[1], Names[Stat], (*Result)[Stat], Base[Stat]);
+					++NumRegressions;
+				}
+			}
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Log, TEXT("Flythrough: no baseline at %s, run with -SaveBaseline to make one"), *BaselineFile);
+	}
+
+	if (bSaveBaseline)
+	{
+		IFileManager::Get().Copy(*BaselineFile, *(BaseName + TEXT(".csv")));
+		UE_LOG(LogTemp, Log, TEXT("Flythrough: baseline saved to %s"), *BaselineFile);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Flythrough %s done, %s.csv/.json, %d regressions (threshold %.0f%%)"),
+		*MapName, *BaseName, NumRegressions, Threshold * 100.0);
+	return NumRegressions;
+}
+
+AStandsFlythroughCameraManager::AStandsFlythroughCameraManager()
+{
+	// the path looks straight down at times
+	ViewPitchMin = -89.0f;
+	ViewPitchMax = 89.0f;
+}
+
+void AStandsFlythroughCameraManager::UpdateViewTarget(FTViewTarget& OutVT, float DeltaTime)
+{
+	const UWorld* World = GetWorld();
+	const AStandsFlythroughGameMode* GameMode = World ? World->GetAuthGameMode<AStandsFlythroughGameMode>() : nullptr;
+	if (GameMode && GameMode->GetFlythroughView(OutVT.POV)) return;
+
+	Super::UpdateViewTarget(OutVT, DeltaTime);
+}
+
+AStandsFlythroughPlayerController::AStandsFlythroughPlayerController()
+{
+	PlayerCameraManagerClass = AStandsFlythroughCameraManager::StaticClass();
+}
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stadium56GameMode.h"
+#include "Stadium56CameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/CameraTypes.h"
+#include "StandsFlythrough.generated.h"
+
+class USplineComponent;
+
+// repeatable runtime benchmark of a stands level: a camera flies a spline at a fixed time step,
+// CSV profiler captures the run, per path segment timings go to Saved/StandsBench and the game exits.
+// exit code 1 on a regression against the baseline, so it works as a gate
+//
+// UnrealEditor Stadium56.uproject /Game/StandsSystem/Maps/Lvl_Stadium?game=StandsFlythrough -game -nullrhi -unattended [params]
+//   -FlythroughSeconds=60  -FlythroughWarmup=3  -FlythroughFps=30
+//   -Baseline=<csv>  default Saved/StandsBench/FlythroughBaseline.csv
+//   -Threshold=0.1  -SaveBaseline  -NoExit
+//   -CullStats=InitViews  CSV timing stats the renderer culls the instances in, summed per frame as cull_ms
+// the path is the first actor tagged PathTag with a spline, else an orbit around the seats.
+// cull timings come from the engine's own stats in the CSV capture, so -nullrhi (no renderer) has none
+UCLASS()
+class STADIUM56_API AStandsFlythroughGameMode : public AStadium56GameMode
+{
+	GENERATED_BODY()
+
+public:
+	AStandsFlythroughGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// camera on the path now. false until the path is built
+	bool GetFlythroughView(FMinimalViewInfo& OutView) const;
+
+protected:
+	// path time after the warmup
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Flythrough", meta = (ClampMin = "1.0"))
+	float FlythroughSeconds;
+
+	// streaming, async seat rebuilds and tree builds settle here, not measured
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Flythrough", meta = (ClampMin = "0.0"))
+	float WarmupSeconds;
+
+	// fixed time step, the camera is at the same place on the same frame every run
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Flythrough", meta = (ClampMin = "1.0"))
+	float FixedFps;
+
+	// actor with a spline component and this tag is the path
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Flythrough")
+	FName PathTag;
+
+	// no tagged path: orbit points, alternating over the top rows and down into the bowl
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Flythrough", meta = (ClampMin = "3"))
+	int32 NumOrbitPoints;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parm|Flythrough")
+	float FieldOfView;
+
+	UPROPERTY(Transient)
+	USplineComponent* Path;
+
+private:
+	enum class EPhase : uint8
+	{
+		Warmup,
+		Capture,
+		Done,
+	};
+
+	struct FSegmentStats
+	{
+		int32 Frames = 0;
+		double FrameMs = 0.0;
+		double GameMs = 0.0;
+		double GameMaxMs = 0.0;
+		double RenderMs = 0.0;
+		double RenderMaxMs = 0.0;
+		// from the CSV capture, once it is written
+		double CullMs = 0.0;
+		double CullMaxMs = 0.0;
+		int32 CullFrames = 0;
+		int64 Instances = 0;
+	};
+
+	// tagged spline, else the orbit. false if there are no seats to orbit
+	bool BuildPath();
+
+	// instances of every stands component now, LOD pools included. gathered every frame, components come and go
+	int32 CountInstances() const;
+
+	void Sample(double FrameMs);
+	void Finish();
+
+	// CullStatNames columns of the written capture into the segments, by its Segment column. false if it has none
+	bool ReadCullStats();
+
+	// summary files, returns the regression count
+	int32 WriteSummary() const;
+
+	// orbit paths look here, tagged paths along the spline
+	FVector LookAtTarget = FVector::ZeroVector;
+	bool bLookAtTarget = false;
+
+	EPhase Phase = EPhase::Warmup;
+	double PhaseTime = 0.0;
+	double LastFrameTime = 0.0;
+	int32 CurrentSegment = INDEX_NONE;
+	TArray<FSegmentStats> Segments;
+	// the CSV capture of this run
+	FString CsvFile;
+	bool bSummaryWritten = false;
+
+	// command line
+	FString BaselineFile;
+	double Threshold = 0.1;
+	bool bSaveBaseline = false;
+	bool bExitWhenDone = true;
+	TArray<FString> CullStatNames;
+	// exit once the CSV file is written
+	bool bExitPending = false;
+	int32 ExitCode = 0;
+};
+
+// camera from the fly-through game mode's path, the player never steers
+UCLASS()
+class STADIUM56_API AStandsFlythroughCameraManager : public AStadium56CameraManager
+{
+	GENERATED_BODY()
+
+public:
+	AStandsFlythroughCameraManager();
+
+protected:
+	virtual void UpdateViewTarget(FTViewTarget& OutVT, float DeltaTime) override;
+};
+
+// spectator with the fly-through camera
+UCLASS()
+class STADIUM56_API AStandsFlythroughPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	AStandsFlythroughPlayerController();
+};
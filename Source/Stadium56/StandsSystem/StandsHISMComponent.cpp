@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsHISMComponent.h"
+#include "StandsSystem/AGlobalSeatManager.h"
+#include "StandsSystem/AGlobalCrowdManager.h"
+
+bool UStandsHISMComponent::IsEditorOnly() const
+{
+	if (Super::IsEditorOnly())
+	{
+		return true;
+	}
+
+#if WITH_EDITOR
+	// asked by the cooker, the source object is never touched
+	if (IsRunningCookCommandlet() && !IsTemplate())
+	{
+		const AActor* Owner = GetOwner();
+		if (const AAGlobalSeatManager* SeatManager = Cast<AAGlobalSeatManager>(Owner))
+		{
+			return SeatManager->HasCurrentBakedData();
+		}
+		if (const AAGlobalCrowdManager* CrowdManager = Cast<AAGlobalCrowdManager>(Owner))
+		{
+			return CrowdManager->HasCurrentBakedData();
+		}
+	}
+#endif
+
+	return false;
+}
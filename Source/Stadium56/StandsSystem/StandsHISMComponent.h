@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "StandsHISMComponent.generated.h"
+
+// seat and crowd HISM of the managers. left out of the cook when the owner has current BakedData,
+// cooked levels recreate it empty and fill it from the bulk data at BeginPlay.
+// the editor level keeps its instances, nothing is cleared for the save
+UCLASS(ClassGroup = Rendering)
+class STADIUM56_API UStandsHISMComponent : public UHierarchicalInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool IsEditorOnly() const override;
+};
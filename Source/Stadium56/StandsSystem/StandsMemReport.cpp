@@ -0,0 +1,278 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsMemReport.h"
+#include "StandsSystem/AGlobalSeatManager.h"
+#include "StandsSystem/AGlobalCrowdManager.h"
+#include "StandsSystem/CrowdBake.h"
+#include "StandsSystem/StandsBakedData.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture.h"
+#include "Materials/MaterialInterface.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+#if !UE_BUILD_SHIPPING
+
+struct FStandsMemReport::FRow
+{
+	FString Name;
+	SIZE_T Bytes = 0;
+	// assets, don't grow with the venue
+	bool bFixed = false;
+};
+
+struct FStandsMemReport::FReport
+{
+	// in print order, same name adds up over managers
+	TArray<FRow> Rows;
+	int32 NumSeats = 0;
+	int32 NumInstances = 0;
+	int32 NumHISMs = 0;
+
+	// textures and meshes shared by managers count once
+	TSet<const UObject*> CountedAssets;
+
+	void Add(const TCHAR* Name, SIZE_T Bytes, bool bFixed = false)
+	{
+		FRow* Row = Rows.FindByPredicate([Name](const FRow& Item) { return Item.Name == Name; });
+		if (!Row)
+		{
+			Row = &Rows.AddDefaulted_GetRef();
+			Row->Name = Name;
+			Row->bFixed = bFixed;
+		}
+		Row->Bytes += Bytes;
+	}
+};
+
+template <typename T>
+static SIZE_T GetNestedAllocatedSize(const TArray<TArray<T>>& Arrays)
+{
+	SIZE_T Bytes = Arrays.GetAllocatedSize();
+	for (const TArray<T>& Inner : Arrays)
+	{
+		Bytes += Inner.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+// instance buffer and custom data on their own, cluster tree, reorder tables and render side copies as the rest
+static void GetHismBytes(UInstancedStaticMeshComponent* HISM, SIZE_T& OutInstances, SIZE_T& OutCustomData, SIZE_T& OutOther)
+{
+	if (!HISM) return;
+
+	const SIZE_T Instances = HISM->PerInstanceSMData.GetAllocatedSize();
+	const SIZE_T CustomData = HISM->PerInstanceSMCustomData.GetAllocatedSize();
+	const SIZE_T Total = HISM->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	OutInstances += Instances;
+	OutCustomData += CustomData;
+	OutOther += Total > Instances + CustomData ? Total - (Instances + CustomData) : 0;
+}
+
+static SIZE_T GetMeshBytes(UStaticMesh* Mesh, TSet<const UObject*>& CountedAssets)
+{
+	bool bAlreadyCounted = false;
+	if (!Mesh) return 0;
+	CountedAssets.Add(Mesh, &bAlreadyCounted);
+	return bAlreadyCounted ? 0 : Mesh->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+}
+
+void FStandsMemReport::AddSeatManager(AAGlobalSeatManager* Manager, FReport& Report)
+{
+	const FSeatLayout& Layout = *Manager->SeatLayout;
+	Report.NumSeats += Layout.Num();
+
+	SIZE_T ChunkBytes = Manager->ChunkData.GetAllocatedSize();
+	SIZE_T Instances = 0;
+	SIZE_T CustomData = 0;
+	SIZE_T Other = 0;
+	for (TPair<TWeakObjectPtr<AActor>, FSeatTransformChunk>& Pair : Manager->ChunkData)
+	{
+		ChunkBytes += Pair.Value.Seats.GetAllocatedSize();
+		GetHismBytes(Pair.Value.HISM, Instances, CustomData, Other);
+		Report.NumHISMs += Pair.Value.HISM ? 1 : 0;
+	}
+	GetHismBytes(Manager->SeatGridHISM, Instances, CustomData, Other);
+
+	Report.Add(TEXT("Seat chunks (ChunkData)"), ChunkBytes);
+	Report.Add(TEXT("Seat layout snapshot"), Layout.GetAllocatedSize() + Manager->SeatLayoutSpawners.GetAllocatedSize());
+	Report.Add(TEXT("Seat HISM instances"), Instances);
+	Report.Add(TEXT("Seat HISM custom data"), CustomData);
+	Report.Add(TEXT("Seat HISM trees + render"), Other);
+
+	// payload while resident, decoded arrays. the decoded seats are usually the snapshot above
+	if (UStandsBakedData* BakedData = Manager->BakedData)
+	{
+		SIZE_T BakedBytes = BakedData->Payload.IsBulkDataLoaded() ? BakedData->Payload.GetBulkDataSize() : 0;
+		BakedBytes += GetNestedAllocatedSize(BakedData->HismSeats) + GetNestedAllocatedSize(BakedData->HismCustomData);
+		if (BakedData->DecodedSeats.IsValid() && BakedData->DecodedSeats.Get() != &Layout)
+		{
+			BakedBytes += BakedData->DecodedSeats->GetAllocatedSize();
+		}
+		Report.Add(TEXT("Baked data"), BakedBytes);
+	}
+
+	Report.Add(TEXT("Seat mesh"), GetMeshBytes(Manager->BuiltSeatMesh.Get(), Report.CountedAssets), true);
+}
+
+void FStandsMemReport::AddCrowdManager(AAGlobalCrowdManager* Manager, FReport& Report)
+{
+	Report.NumInstances += Manager->GetNumCrowdInstances();
+
+	SIZE_T Instances = 0;
+	SIZE_T CustomData = 0;
+	SIZE_T Other = 0;
+	for (UHierarchicalInstancedStaticMeshComponent* HISM : Manager->CrowdHISMs)
+	{
+		GetHismBytes(HISM, Instances, CustomData, Other);
+		Report.NumHISMs += HISM ? 1 : 0;
+	}
+	Report.Add(TEXT("Crowd HISM instances"), Instances);
+	Report.Add(TEXT("Crowd HISM custom data"), CustomData);
+	Report.Add(TEXT("Crowd HISM trees + render"), Other);
+
+	Report.Add(TEXT("Crowd delta bookkeeping"), Manager->SeatInstanceSlots.GetAllocatedSize()
+		+ GetNestedAllocatedSize(Manager->HismInstanceSeats) + Manager->BakedVolumeBoxes.GetAllocatedSize());
+
+	// LOD pools only exist in game worlds with crowd LOD on
+	if (Manager->LodPoolHISMs.Num() > 0)
+	{
+		SIZE_T PoolInstances = 0;
+		SIZE_T PoolCustomData = 0;
+		SIZE_T PoolOther = 0;
+		for (UHierarchicalInstancedStaticMeshComponent* Pool : Manager->LodPoolHISMs)
+		{
+			GetHismBytes(Pool, PoolInstances, PoolCustomData, PoolOther);
+			Report.NumHISMs += Pool ? 1 : 0;
+		}
+		Report.Add(TEXT("Crowd LOD pool instances"), PoolInstances + PoolCustomData);
+		Report.Add(TEXT("Crowd LOD pool trees + render"), PoolOther);
+		Report.Add(TEXT("Crowd LOD state"), Manager->LodSections.GetAllocatedSize() + Manager->LodSeatHism.GetAllocatedSize()
+			+ Manager->LodSeatCustomData.GetAllocatedSize() + Manager->LodSeatSlots.GetAllocatedSize() + GetNestedAllocatedSize(Manager->LodPoolInstanceSeats));
+	}
+
+	// only while an async bake runs
+	if (const FCrowdBakePlan* Plan = Manager->AsyncBake.Get())
+	{
+		Report.Add(TEXT("Crowd bake plan (in flight)"), GetNestedAllocatedSize(Plan->HismTransforms) + GetNestedAllocatedSize(Plan->HismCustomData)
+			+ GetNestedAllocatedSize(Plan->HismSeats) + Plan->SliceTransforms.GetAllocatedSize() + Plan->SliceCustomData.GetAllocatedSize());
+	}
+
+	// VAT position/rotation textures are texture parameters of the clip materials.
+	// resident mips now, all mips is what a close up of every clip would stream in
+	SIZE_T TextureBytes = 0;
+	SIZE_T TextureAllMipsBytes = 0;
+	SIZE_T MeshBytes = 0;
+	for (const FCharacterVariant& Variant : Manager->CrowdCharacterVariants)
+	{
+		MeshBytes += GetMeshBytes(Variant.Mesh, Report.CountedAssets);
+		MeshBytes += GetMeshBytes(Variant.FrozenMesh, Report.CountedAssets);
+
+		TArray<UMaterialInterface*, TInlineAllocator<8>> Materials(Variant.VATMats);
+		Materials.Add(Variant.ClipArrayMat);
+		for (UMaterialInterface* Material : Materials)
+		{
+			if (!Material) continue;
+
+			TArray<FMaterialParameterInfo> ParameterInfos;
+			TArray<FGuid> ParameterIds;
+			Material->GetAllTextureParameterInfo(ParameterInfos, ParameterIds);
+			for (const FMaterialParameterInfo& Info : ParameterInfos)
+			{
+				UTexture* Texture = nullptr;
+				bool bAlreadyCounted = false;
+				if (!Material->GetTextureParameterValue(Info, Texture) || !Texture) continue;
+				Report.CountedAssets.Add(Texture, &bAlreadyCounted);
+				if (bAlreadyCounted) continue;
+
+				const SIZE_T Resident = Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+				const SIZE_T AllMips = Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+				TextureBytes += Resident;
+				TextureAllMipsBytes += AllMips;
+				UE_LOG(LogTemp, Verbose, TEXT("  %s: %.1f KB resident, %.1f KB all mips"), *Texture->GetPathName(), Resident / 1024.0, AllMips / 1024.0);
+			}
+		}
+	}
+	Report.Add(TEXT("Crowd meshes"), MeshBytes, true);
+	Report.Add(TEXT("VAT textures (resident)"), TextureBytes, true);
+	Report.Add(TEXT("VAT textures (all mips)"), TextureAllMipsBytes, true);
+}
+
+void FStandsMemReport::Run(UWorld* World, int32 ProjectedSeats)
+{
+	if (!World) return;
+
+	FReport Report;
+	int32 NumManagers = 0;
+	for (TActorIterator<AAGlobalSeatManager> It(World); It; ++It)
+	{
+		AddSeatManager(*It, Report);
+		++NumManagers;
+	}
+	for (TActorIterator<AAGlobalCrowdManager> It(World); It; ++It)
+	{
+		AddCrowdManager(*It, Report);
+		++NumManagers;
+	}
+	if (NumManagers == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("MemReport: no seat or crowd managers in %s"), *World->GetName());
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("MemReport %s: %d managers, %d seats, %d crowd instances, %d HISMs"),
+		*World->GetName(), NumManagers, Report.NumSeats, Report.NumInstances, Report.NumHISMs);
+
+	const double PerSeat = Report.NumSeats > 0 ? 1.0 / Report.NumSeats : 0.0;
+	const double PerInstance = Report.NumInstances > 0 ? 1.0 / Report.NumInstances : 0.0;
+	SIZE_T ScalingBytes = 0;
+	SIZE_T FixedBytes = 0;
+	for (const FRow& Row : Report.Rows)
+	{
+		if (Row.bFixed)
+		{
+			UE_LOG(LogTemp, Log, TEXT("  %-30s %10.1f KB   fixed"), *Row.Name, Row.Bytes / 1024.0);
+			// all mips is the worst case of the resident row, not on top of it
+			if (!Row.Name.Contains(TEXT("all mips"))) FixedBytes += Row.Bytes;
+			continue;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("  %-30s %10.1f KB %8.1f B/seat %8.1f B/instance"),
+			*Row.Name, Row.Bytes / 1024.0, Row.Bytes * PerSeat, Row.Bytes * PerInstance);
+		ScalingBytes += Row.Bytes;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("  %-30s %10.1f KB %8.1f B/seat %8.1f B/instance, + %.1f MB fixed"),
+		TEXT("total"), ScalingBytes / 1024.0, ScalingBytes * PerSeat, ScalingBytes * PerInstance, FixedBytes / (1024.0 * 1024.0));
+
+	// same crowd density and HISM count, everything per seat scales linearly
+	if (Report.NumSeats > 0 && ProjectedSeats > 0)
+	{
+		const double ProjectedMB = ScalingBytes * PerSeat * ProjectedSeats / (1024.0 * 1024.0);
+		UE_LOG(LogTemp, Log, TEXT("  at %d seats (%d crowd instances): %.1f MB + %.1f MB fixed = %.1f MB"),
+			ProjectedSeats, FMath::RoundToInt32(static_cast<double>(Report.NumInstances) * PerSeat * ProjectedSeats),
+			ProjectedMB, FixedBytes / (1024.0 * 1024.0), ProjectedMB + FixedBytes / (1024.0 * 1024.0));
+	}
+}
+
+static void MemReport(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 ProjectedSeats = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+	FStandsMemReport::Run(World, ProjectedSeats);
+}
+
+static FAutoConsoleCommand MemReportCmd(
+	TEXT("Stands.MemReport"),
+	TEXT("Bytes of seats, crowd HISMs, baked data and VAT textures in this world, per seat and per crowd instance. Arg: seats to project to, default 100000"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&MemReport));
+
+#else
+
+void FStandsMemReport::Run(UWorld* World, int32 ProjectedSeats)
+{
+	UE_LOG(LogTemp, Warning, TEXT("Stands.MemReport is not in shipping builds"));
+}
+
+#endif
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AAGlobalSeatManager;
+class AAGlobalCrowdManager;
+
+// what the stands in a world take, by structure, non-shipping. for venue budgets:
+// per seat and per crowd instance bytes, then the same density scaled to a target seat count
+//
+// Stands.MemReport [Seats]  Seats default 100000
+// the Stands and SidefxLabsRuntime LLM tags (-llm, stat LLMFULL) should land near the scaling total
+class STADIUM56_API FStandsMemReport
+{
+public:
+	static void Run(UWorld* World, int32 ProjectedSeats);
+
+private:
+	struct FRow;
+	struct FReport;
+
+	static void AddSeatManager(AAGlobalSeatManager* Manager, FReport& Report);
+	static void AddCrowdManager(AAGlobalCrowdManager* Manager, FReport& Report);
+};
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsRandom.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if !UE_BUILD_SHIPPING || WITH_DEV_AUTOMATION_TESTS
+
+// pearson correlation of two equally long sample sets
+static double Correlation(const TArray<float>& A, const TArray<float>& B)
+{
+	const int32 Num = A.Num();
+	double SumA = 0.0, SumB = 0.0, SumAA = 0.0, SumBB = 0.0, SumAB = 0.0;
+	for (int32 i = 0; i < Num; ++i)
+	{
+		SumA += A[i];
+		SumB += B[i];
+		SumAA += A[i] * A[i];
+		SumBB += B[i] * B[i];
+		SumAB += A[i] * B[i];
+	}
+	const double CovAB = SumAB / Num - (SumA / Num) * (SumB / Num);
+	const double VarA = SumAA / Num - FMath::Square(SumA / Num);
+	const double VarB = SumBB / Num - FMath::Square(SumB / Num);
+	return CovAB / FMath::Sqrt(FMath::Max(VarA * VarB, UE_DOUBLE_SMALL_NUMBER));
+}
+
+// chi-square of Fraction() over equal buckets
+static double ChiSquare(const TArray<float>& Samples, int32 NumBuckets)
+{
+	TArray<int32> Counts;
+	Counts.SetNumZeroed(NumBuckets);
+	for (const float Sample : Samples)
+	{
+		++Counts[FMath::Min(static_cast<int32>(Sample * NumBuckets), NumBuckets - 1)];
+	}
+
+	const double Expected = static_cast<double>(Samples.Num()) / NumBuckets;
+	double Chi2 = 0.0;
+	for (const int32 Count : Counts)
+	{
+		Chi2 += FMath::Square(Count - Expected) / Expected;
+	}
+	return Chi2;
+}
+
+#endif
+
+#if WITH_DEV_AUTOMATION_TESTS
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStandsRandomTest, "Stands.Random.Distribution",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+// uniform per stream, neighbouring seats and streams uncorrelated, ranges in bounds, same value every call
+bool FStandsRandomTest::RunTest(const FString& Parameters)
+{
+	const int32 NumSamples = 1000000;
+	const int32 Seed = 12345;
+	const int32 NumBuckets = 256;
+	// df = 255, p ~ 0.001 per check
+	const double Chi2Limit = 330.0;
+	// ~5 sigma
+	const double CorrLimit = 5.0 / FMath::Sqrt(static_cast<double>(NumSamples));
+
+	const EStandsRandomStream Streams[] = { EStandsRandomStream::Density, EStandsRandomStream::Mesh, EStandsRandomStream::Material,
+		EStandsRandomStream::TimeOffset, EStandsRandomStream::LodThinning };
+
+	TArray<TArray<float>> StreamSamples;
+	StreamSamples.SetNum(UE_ARRAY_COUNT(Streams));
+	TArray<float> DensityNext;
+	DensityNext.SetNumUninitialized(NumSamples);
+	for (int32 StreamIdx = 0; StreamIdx < UE_ARRAY_COUNT(Streams); ++StreamIdx)
+	{
+		StreamSamples[StreamIdx].SetNumUninitialized(NumSamples);
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			StreamSamples[StreamIdx][i] = FStandsRandom::Fraction(Seed, i, Streams[StreamIdx]);
+		}
+		TestTrue(FString::Printf(TEXT("stream %d uniform"), StreamIdx), ChiSquare(StreamSamples[StreamIdx], NumBuckets) < Chi2Limit);
+	}
+
+	// neighbouring ids, the worst case for the old FRandomStream(seed + hash) seeding
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		DensityNext[i] = FStandsRandom::Fraction(Seed, i + 1, EStandsRandomStream::Density);
+	}
+	TestTrue(TEXT("neighbouring seats uncorrelated"), FMath::Abs(Correlation(StreamSamples[0], DensityNext)) < CorrLimit);
+	for (int32 StreamIdx = 1; StreamIdx < UE_ARRAY_COUNT(Streams); ++StreamIdx)
+	{
+		TestTrue(FString::Printf(TEXT("streams 0 and %d uncorrelated"), StreamIdx), FMath::Abs(Correlation(StreamSamples[0], StreamSamples[StreamIdx])) < CorrLimit);
+	}
+
+	// neighbouring seeds, a bake with the next seed must not look like the last one
+	TArray<float> NextSeed;
+	NextSeed.SetNumUninitialized(NumSamples);
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		NextSeed[i] = FStandsRandom::Fraction(Seed + 1, i, EStandsRandomStream::Density);
+	}
+	TestTrue(TEXT("neighbouring seeds uncorrelated"), FMath::Abs(Correlation(StreamSamples[0], NextSeed)) < CorrLimit);
+
+	// RandRange: in bounds, every value hit about equally often
+	const int32 RangeMin = -3;
+	const int32 RangeMax = 6;
+	TArray<int32> RangeCounts;
+	RangeCounts.SetNumZeroed(RangeMax - RangeMin + 1);
+	bool bInRange = true;
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		const int32 Value = FStandsRandom::RandRange(Seed, i, EStandsRandomStream::Mesh, RangeMin, RangeMax);
+		bInRange &= Value >= RangeMin && Value <= RangeMax;
+		if (Value >= RangeMin && Value <= RangeMax) ++RangeCounts[Value - RangeMin];
+	}
+	TestTrue(TEXT("RandRange in bounds"), bInRange);
+	const double RangeExpected = static_cast<double>(NumSamples) / RangeCounts.Num();
+	double RangeChi2 = 0.0;
+	for (const int32 Count : RangeCounts)
+	{
+		RangeChi2 += FMath::Square(Count - RangeExpected) / RangeExpected;
+	}
+	// df = 9, p ~ 0.001
+	TestTrue(TEXT("RandRange uniform"), RangeChi2 < 27.9);
+	TestEqual(TEXT("RandRange single value"), FStandsRandom::RandRange(Seed, 7, EStandsRandomStream::Mesh, 5, 5), 5);
+
+	// stateless: same inputs, same value
+	TestEqual(TEXT("deterministic"), FStandsRandom::Hash(Seed, 42, EStandsRandomStream::Material), FStandsRandom::Hash(Seed, 42, EStandsRandomStream::Material));
+	return true;
+}
+#endif
+
+#if !UE_BUILD_SHIPPING
+
+// Stands.BenchRandom [Samples]
+// FStandsRandom against the old FRandomStream(seed + hash) path: the old path's statistics, then throughput of both
+static void BenchStandsRandom(const TArray<FString>& Args)
+{
+	const int32 NumSamples = Args.Num() > 0 ? FMath::Max(1000, FCString::Atoi(*Args[0])) : 1000000;
+	const int32 Seed = 12345;
+	const int32 NumBuckets = 256;
+
+	TArray<float> Density, DensityNext, OldFirst, OldNext;
+	Density.SetNumUninitialized(NumSamples);
+	DensityNext.SetNumUninitialized(NumSamples);
+	OldFirst.SetNumUninitialized(NumSamples);
+	OldNext.SetNumUninitialized(NumSamples);
+
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		Density[i] = FStandsRandom::Fraction(Seed, i, EStandsRandomStream::Density);
+		DensityNext[i] = FStandsRandom::Fraction(Seed, i + 1, EStandsRandomStream::Density);
+		OldFirst[i] = FRandomStream(Seed + i).GetFraction();
+		OldNext[i] = FRandomStream(Seed + i + 1).GetFraction();
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("BenchRandom %d samples: FStandsRandom chi2 %.1f, seat corr %.5f; old FRandomStream(seed + hash) chi2 %.1f, seat corr %.5f"),
+		NumSamples, ChiSquare(Density, NumBuckets), Correlation(Density, DensityNext), ChiSquare(OldFirst, NumBuckets), Correlation(OldFirst, OldNext));
+
+	// throughput
+	uint32 Sink = 0;
+	const double HashStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		Sink ^= FStandsRandom::Hash(Seed, i, EStandsRandomStream::Material);
+	}
+	const double HashSeconds = FPlatformTime::Seconds() - HashStart;
+
+	float OldSink = 0.0f;
+	const double OldStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		OldSink += FRandomStream(Seed + i).GetFraction();
+	}
+	const double OldSeconds = FPlatformTime::Seconds() - OldStart;
+
+	UE_LOG(LogTemp, Log, TEXT("BenchRandom throughput: FStandsRandom %.1f M/s, FRandomStream %.1f M/s (%u %.1f)"),
+		NumSamples / FMath::Max(HashSeconds, 1e-9) / 1e6, NumSamples / FMath::Max(OldSeconds, 1e-9) / 1e6, Sink, OldSink);
+}
+
+static FAutoConsoleCommand BenchStandsRandomCmd(
+	TEXT("Stands.BenchRandom"),
+	TEXT("Statistics of the old random path and throughput of both crowd random generators. Arg: sample count (default 1000000)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchStandsRandom));
+
+#endif
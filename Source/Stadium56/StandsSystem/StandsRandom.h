@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// one independent sequence per kind of pick, so adding a pick never shifts the others
+enum class EStandsRandomStream : uint32
+{
+	Density = 0,
+	Mesh = 1,
+	Material = 2,
+	TimeOffset = 3,
+	// crowd LOD, Far tier keeps a seat below LodFarKeepFraction
+	LodThinning = 4,
+};
+
+// stateless counter based random. value = hash(seed, seat id, stream)
+// no state -> same bake every time, and safe from any thread
+struct FStandsRandom
+{
+	// splitmix64 finalizer, bijective on 64 bits
+	static FORCEINLINE uint64 Mix64(uint64 X)
+	{
+		X ^= X >> 30;
+		X *= 0xBF58476D1CE4E5B9ull;
+		X ^= X >> 27;
+		X *= 0x94D049BB133111EBull;
+		X ^= X >> 31;
+		return X;
+	}
+
+	static FORCEINLINE uint32 Hash(int32 Seed, uint32 SeatId, EStandsRandomStream Stream)
+	{
+		const uint64 Key = (static_cast<uint64>(static_cast<uint32>(Seed)) << 32) | SeatId;
+		const uint64 StreamKey = (static_cast<uint64>(Stream) + 1) * 0x9E3779B97F4A7C15ull;
+		return static_cast<uint32>(Mix64(Mix64(Key) ^ StreamKey) >> 32);
+	}
+
+	// [0, 1)
+	static FORCEINLINE float Fraction(int32 Seed, uint32 SeatId, EStandsRandomStream Stream)
+	{
+		return (Hash(Seed, SeatId, Stream) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// [Min, Max], no modulo bias worth caring about
+	static FORCEINLINE int32 RandRange(int32 Seed, uint32 SeatId, EStandsRandomStream Stream, int32 Min, int32 Max)
+	{
+		const uint64 Range = static_cast<uint64>(static_cast<int64>(Max) - Min + 1);
+		return Min + static_cast<int32>((Hash(Seed, SeatId, Stream) * Range) >> 32);
+	}
+
+	// stable id from a seat position, rounded to cm so it survives float noise
+	static FORCEINLINE uint32 SeatId(const FVector& Location)
+	{
+		const uint32 X = static_cast<uint32>(FMath::RoundToInt32(Location.X));
+		const uint32 Y = static_cast<uint32>(FMath::RoundToInt32(Location.Y));
+		const uint32 Z = static_cast<uint32>(FMath::RoundToInt32(Location.Z));
+		return static_cast<uint32>(Mix64(Mix64((static_cast<uint64>(X) << 32) | Y) ^ Z));
+	}
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandsSystem/StandsStats.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(StandsChannel);
+
+LLM_DEFINE_TAG(Stands);
+
+DEFINE_STAT(STAT_Stands_GenerateSeats);
+DEFINE_STAT(STAT_Stands_GenerateTransforms);
+DEFINE_STAT(STAT_Stands_RebuildHISMs);
+DEFINE_STAT(STAT_Stands_CombineTransforms);
+DEFINE_STAT(STAT_Stands_CombineSeatLayout);
+DEFINE_STAT(STAT_Stands_FillSeatHISM);
+DEFINE_STAT(STAT_Stands_MortonSort);
+
+DEFINE_STAT(STAT_Stands_SetupHISMComponents);
+DEFINE_STAT(STAT_Stands_BuildBakeContext);
+DEFINE_STAT(STAT_Stands_FilterSeats);
+DEFINE_STAT(STAT_Stands_BuildBakePlan);
+DEFINE_STAT(STAT_Stands_PopulateHISMs);
+DEFINE_STAT(STAT_Stands_RebakeVolume);
+DEFINE_STAT(STAT_Stands_LoadBakedData);
+DEFINE_STAT(STAT_Stands_DecodeBakedData);
+DEFINE_STAT(STAT_Stands_CrowdLod);
+
+DEFINE_STAT(STAT_Stands_NumSeats);
+DEFINE_STAT(STAT_Stands_NumSpawners);
+DEFINE_STAT(STAT_Stands_NumVolumes);
+DEFINE_STAT(STAT_Stands_NumCrowdInstances);
+DEFINE_STAT(STAT_Stands_NumCrowdComponents);
+DEFINE_STAT(STAT_Stands_NumLodFull);
+DEFINE_STAT(STAT_Stands_NumLodFrozen);
+DEFINE_STAT(STAT_Stands_NumLodFar);
+
+TRACE_DECLARE_INT_COUNTER(StandsSeats, TEXT("Stands/Seats"));
+TRACE_DECLARE_INT_COUNTER(StandsSpawners, TEXT("Stands/Seat Spawners"));
+TRACE_DECLARE_INT_COUNTER(StandsVolumes, TEXT("Stands/Crowd Volumes"));
+TRACE_DECLARE_INT_COUNTER(StandsCrowdInstances, TEXT("Stands/Crowd Instances"));
+TRACE_DECLARE_INT_COUNTER(StandsCrowdComponents, TEXT("Stands/Crowd Components"));
+TRACE_DECLARE_INT_COUNTER(StandsLodFull, TEXT("Stands/Crowd LOD Full"));
+TRACE_DECLARE_INT_COUNTER(StandsLodFrozen, TEXT("Stands/Crowd LOD Frozen"));
+TRACE_DECLARE_INT_COUNTER(StandsLodFar, TEXT("Stands/Crowd LOD Far"));
+
+// process totals for the trace counters, the stats keep their own
+static int64 TotalSeats = 0;
+static int64 TotalSpawners = 0;
+static int64 TotalVolumes = 0;
+static int64 TotalCrowdInstances = 0;
+static int64 TotalCrowdComponents = 0;
+static int64 TotalLodFull = 0;
+static int64 TotalLodFrozen = 0;
+static int64 TotalLodFar = 0;
+
+// moves one manager's share of a counter from Reported to Value
+#define STANDS_UPDATE_COUNTER(Stat, TraceCounter, Total, Reported, Value) \
+	{ \
+		const int32 Delta = (Value) - (Reported); \
+		INC_DWORD_STAT_BY(Stat, Delta); \
+		Total += Delta; \
+		TRACE_COUNTER_SET(TraceCounter, Total); \
+		Reported = (Value); \
+	}
+
+void StandsStats::UpdateSeatCounters(FSeatCounters& InOutReported, int32 NumSeats, int32 NumSpawners)
+{
+	check(IsInGameThread());
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumSeats, StandsSeats, TotalSeats, InOutReported.NumSeats, NumSeats);
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumSpawners, StandsSpawners, TotalSpawners, InOutReported.NumSpawners, NumSpawners);
+}
+
+void StandsStats::UpdateCrowdCounters(FCrowdCounters& InOutReported, int32 NumVolumes, int32 NumInstances, int32 NumComponents)
+{
+	check(IsInGameThread());
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumVolumes, StandsVolumes, TotalVolumes, InOutReported.NumVolumes, NumVolumes);
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumCrowdInstances, StandsCrowdInstances, TotalCrowdInstances, InOutReported.NumInstances, NumInstances);
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumCrowdComponents, StandsCrowdComponents, TotalCrowdComponents, InOutReported.NumComponents, NumComponents);
+}
+
+void StandsStats::UpdateCrowdLodCounters(FCrowdLodCounters& InOutReported, int32 NumFull, int32 NumFrozen, int32 NumFar)
+{
+	check(IsInGameThread());
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumLodFull, StandsLodFull, TotalLodFull, InOutReported.NumFull, NumFull);
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumLodFrozen, StandsLodFrozen, TotalLodFrozen, InOutReported.NumFrozen, NumFrozen);
+	STANDS_UPDATE_COUNTER(STAT_Stands_NumLodFar, StandsLodFar, TotalLodFar, InOutReported.NumFar, NumFar);
+}
+
+#undef STANDS_UPDATE_COUNTER
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "HAL/LowLevelMemTracker.h"
+
+// Insights: -trace=cpu,counters. -trace=Stands too in builds without stats. in game: stat Stands
+UE_TRACE_CHANNEL_EXTERN(StandsChannel, STADIUM56_API);
+
+DECLARE_STATS_GROUP(TEXT("Stands"), STATGROUP_Stands, STATCAT_Advanced);
+
+// LLM tag of everything the stands allocate: -llm, then stat LLMFULL or memreport. Stands.MemReport breaks it down
+LLM_DECLARE_TAG_API(Stands, STADIUM56_API);
+
+// seats
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Seats"), STAT_Stands_GenerateSeats, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Transforms"), STAT_Stands_GenerateTransforms, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rebuild HISMs"), STAT_Stands_RebuildHISMs, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Combine Transforms"), STAT_Stands_CombineTransforms, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Combine Seat Layout"), STAT_Stands_CombineSeatLayout, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fill Seat HISM"), STAT_Stands_FillSeatHISM, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Morton Sort"), STAT_Stands_MortonSort, STATGROUP_Stands, STADIUM56_API);
+
+// crowd
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Setup HISM Components"), STAT_Stands_SetupHISMComponents, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Bake Context"), STAT_Stands_BuildBakeContext, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Filter Seats"), STAT_Stands_FilterSeats, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Bake Plan"), STAT_Stands_BuildBakePlan, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Populate HISMs"), STAT_Stands_PopulateHISMs, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rebake Volume"), STAT_Stands_RebakeVolume, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Baked Data"), STAT_Stands_LoadBakedData, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode Baked Data"), STAT_Stands_DecodeBakedData, STATGROUP_Stands, STADIUM56_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd LOD"), STAT_Stands_CrowdLod, STATGROUP_Stands, STADIUM56_API);
+
+// what is live, summed over every manager. each one updates its share after a rebuild or bake
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Seats"), STAT_Stands_NumSeats, STATGROUP_Stands, STADIUM56_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Seat Spawners"), STAT_Stands_NumSpawners, STATGROUP_Stands, STADIUM56_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Volumes"), STAT_Stands_NumVolumes, STATGROUP_Stands, STADIUM56_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Instances"), STAT_Stands_NumCrowdInstances, STATGROUP_Stands, STADIUM56_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Components"), STAT_Stands_NumCrowdComponents, STATGROUP_Stands, STADIUM56_API);
+// crowd LOD, members per tier as moved so far. culled Far members are not counted
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd LOD Full"), STAT_Stands_NumLodFull, STATGROUP_Stands, STADIUM56_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd LOD Frozen"), STAT_Stands_NumLodFrozen, STATGROUP_Stands, STADIUM56_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd LOD Far"), STAT_Stands_NumLodFar, STATGROUP_Stands, STADIUM56_API);
+
+// one timer per scope: the stat Stands cycle counter, which is also the Insights cpu timer when the cpu channel is on.
+// builds without stats get a cpu scope on the Stands channel instead. allocations inside go to the Stands LLM tag
+#if STATS
+#define STANDS_SCOPE(Stat) \
+	LLM_SCOPE_BYTAG(Stands); \
+	SCOPE_CYCLE_COUNTER(Stat)
+#else
+#define STANDS_SCOPE(Stat) \
+	LLM_SCOPE_BYTAG(Stands); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, StandsChannel)
+#endif
+
+// stat Stands and the trace counters of the same name, game thread.
+// a manager keeps what it last reported, so the totals add up over managers and it can take its share back (all 0)
+namespace StandsStats
+{
+	struct FSeatCounters
+	{
+		int32 NumSeats = 0;
+		int32 NumSpawners = 0;
+	};
+
+	struct FCrowdCounters
+	{
+		int32 NumVolumes = 0;
+		int32 NumInstances = 0;
+		int32 NumComponents = 0;
+	};
+
+	struct FCrowdLodCounters
+	{
+		int32 NumFull = 0;
+		int32 NumFrozen = 0;
+		int32 NumFar = 0;
+	};
+
+	STADIUM56_API void UpdateSeatCounters(FSeatCounters& InOutReported, int32 NumSeats, int32 NumSpawners);
+	STADIUM56_API void UpdateCrowdCounters(FCrowdCounters& InOutReported, int32 NumVolumes, int32 NumInstances, int32 NumComponents);
+	STADIUM56_API void UpdateCrowdLodCounters(FCrowdLodCounters& InOutReported, int32 NumFull, int32 NumFrozen, int32 NumFar);
+}